@@ -3,12 +3,15 @@
  *
  * Design philosophy:
  * - Simple state machine per connection
- * - Non-blocking I/O with select()
+ * - Non-blocking I/O on the event backend API (src/event); built with
+ *   the dense poll() backend by default, any backend can be linked
  */
 
 #include "aio_server.h"
 #include "../common/http.h"
 #include "../common/util.h"
+#include "../common/timer_wheel.h"
+#include "../event/event_backend.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -18,7 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -26,13 +29,20 @@
 /* Configuration constants */
 enum
 {
-  kMaxClients = 100,            /* Limited for stack allocation */
+  kDefaultMaxClients = 10000,   /* Default client cap */
+  kMaxClientsLimit = 100000,    /* Upper bound for --max-clients */
   kRequestBufferSize = 8192,    /* Larger for modern HTTP */
   kResponseBufferSize = 65536,  /* 64KB for optimal I/O */
   kPathBufferSize = 2048,       /* PATH_MAX compatible */
   kHeaderBufferSize = 512,      /* Response header size */
   kListenBacklog = 512,         /* Higher for production */
-  kSelectTimeoutMs = 50         /* Lower latency checks */
+  kMaxEvents = 1024,            /* Events handled per wait */
+  kIdleTimeoutMs = 5000,        /* No request bytes yet */
+  kHeaderTimeoutMs = 10000,     /* First byte to complete headers */
+  kSendTimeoutMs = 10000,       /* Max gap between send progress */
+  kKeepAliveTimeoutMs = 5000,   /* Idle between keep-alive requests */
+  kKeepAliveMax = 100,          /* Requests per connection */
+  kLingerTimeoutMs = 2000       /* Discarding input after the last response */
 };
 
 /* Client connection states */
@@ -44,14 +54,18 @@ typedef enum
 } ClientState;
 
 /* Client connection structure */
-typedef struct
+typedef struct Client
 {
   int fd;
   ClientState state;
+  unsigned interest; /* kEbRead or kEbWrite, as registered */
 
-  /* Request handling */
-  char request_buffer[kRequestBufferSize];
+  /* Request handling (allocated on first use, kept while pooled) */
+  char *request_buffer;
   size_t request_size;
+  http_parser_t *parser; /* Same allocation as request_buffer */
+  int keep_alive;        /* Current response keeps the connection open */
+  int requests;          /* Served so far, for kKeepAliveMax */
 
   /* Response handling */
   char *response_buffer;
@@ -62,36 +76,72 @@ typedef struct
   int file_fd;
   off_t file_offset;
   off_t file_size;
+
+  /* Idle/header/send deadline */
+  TimerNode timer;
+
+  /* For client pool */
+  struct Client *next;
 } Client;
 
-/* Server context */
+/*
+ * Server context
+ *
+ * The listener is registered with NULL udata, clients with their Client.
+ */
 typedef struct
 {
   int listen_fd;
   const char *doc_root;
-  Client clients[kMaxClients];
+
+  /* Client pool */
+  Client *clients;
+  Client *free_list;
+  int max_clients;
   int num_clients;
 
+  /* Readiness and timeouts */
+  EventBackend *eb;
+
   /* Statistics */
   unsigned long total_requests;
   unsigned long total_bytes_sent;
+  unsigned long total_timeouts;
 } Server;
 
 /* Function prototypes */
+static int increase_fd_limit(int max_clients);
 static int create_listen_socket(const char *bind_addr, int port);
 static void accept_new_clients(Server *server);
 static void handle_client_read(Server *server, Client *client);
 static void handle_client_write(Server *server, Client *client);
-static void process_http_request(Server *server, Client *client);
-static void prepare_file_response(Client *client, const char *file_path);
-static void prepare_error_response(Client *client, int status_code);
-static void close_client(Client *client);
+static void handle_client_linger(Server *server, Client *client);
+static void parse_client_request(Server *server, Client *client);
+static int send_client_response(Server *server, Client *client);
+static void next_client_request(Server *server, Client *client);
+static void process_http_request(Server *server, Client *client,
+                                 const http_req_t *request);
+static void prepare_file_response(Server *server, Client *client, const char *file_path);
+static void prepare_error_response(Server *server, Client *client, int status_code);
+static void update_interest(Server *server, Client *client);
+static void linger_client(Server *server, Client *client);
+static void close_client(Server *server, Client *client);
+static void expire_clients(Server *server);
 static void reset_client(Client *client);
 
 /**
  * Main server entry point
  */
 int run_aio_server(const char *bind_addr, int port, const char *doc_root)
+{
+  return run_aio_server_clients(bind_addr, port, doc_root, kDefaultMaxClients);
+}
+
+/**
+ * Server entry point with a configurable client cap
+ */
+int run_aio_server_clients(const char *bind_addr, int port,
+                           const char *doc_root, int max_clients)
 {
   if (!doc_root)
   {
@@ -99,128 +149,183 @@ int run_aio_server(const char *bind_addr, int port, const char *doc_root)
     return -1;
   }
 
+  if (max_clients < 1 || max_clients > kMaxClientsLimit)
+  {
+    fprintf(stderr, "Error: max clients must be between 1 and %d\n",
+            kMaxClientsLimit);
+    return -1;
+  }
+
+  /* Make room for every client plus the listener */
+  if (increase_fd_limit(max_clients) < 0)
+  {
+    fprintf(stderr, "Warning: Could not increase fd limit\n");
+  }
+
   /* Ignore SIGPIPE */
   signal(SIGPIPE, SIG_IGN);
 
-  /* Initialize server context - allocate on heap to avoid stack overflow */
+  /* Initialize server context */
   Server *server = calloc(1, sizeof(Server));
   if (!server) {
     fprintf(stderr, "Failed to allocate server context\n");
     return -1;
   }
   server->doc_root = doc_root;
+  server->max_clients = max_clients;
+
+  server->clients = calloc(max_clients, sizeof(Client));
+  server->eb = eb_create(max_clients + 1);
+  if (!server->clients || !server->eb)
+  {
+    fprintf(stderr, "Failed to allocate client pool\n");
+    free(server->clients);
+    eb_destroy(server->eb);
+    free(server);
+    return -1;
+  }
 
   /* Create listening socket */
   server->listen_fd = create_listen_socket(bind_addr, port);
   if (server->listen_fd < 0)
   {
+    free(server->clients);
+    eb_destroy(server->eb);
     free(server);
     return -1;
   }
 
-  /* Initialize client slots */
-  for (int i = 0; i < kMaxClients; i++)
+  /* Initialize client pool */
+  for (int i = 0; i < max_clients; i++)
   {
     reset_client(&server->clients[i]);
+    server->clients[i].next = (i + 1 < max_clients) ? &server->clients[i + 1] : NULL;
   }
+  server->free_list = &server->clients[0];
 
-  fprintf(stderr, "AIO server listening on %s:%d (doc_root: %s)\n",
-          bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
-
-  /* Main event loop */
-  while (1)
+  /* Listener carries NULL udata */
+  if (eb_register(server->eb, server->listen_fd, kEbRead, NULL) < 0)
   {
-    fd_set read_fds, write_fds;
-    FD_ZERO(&read_fds);
-    FD_ZERO(&write_fds);
-
-    /* Add listen socket */
-    FD_SET(server->listen_fd, &read_fds);
-    int max_fd = server->listen_fd;
-
-    /* Add client sockets */
-    for (int i = 0; i < kMaxClients; i++)
-    {
-      Client *client = &server->clients[i];
-      if (client->fd < 0)
-        continue;
-
-      if (client->state == STATE_READING_REQUEST)
-      {
-        FD_SET(client->fd, &read_fds);
-      }
-      else if (client->state == STATE_SENDING_RESPONSE)
-      {
-        FD_SET(client->fd, &write_fds);
-      }
+    perror("eb_register");
+    close(server->listen_fd);
+    free(server->clients);
+    eb_destroy(server->eb);
+    free(server);
+    return -1;
+  }
 
-      if (client->fd > max_fd)
-      {
-        max_fd = client->fd;
-      }
-    }
+  fprintf(stderr, "AIO server (%s) listening on %s:%d (doc_root: %s)\n",
+          eb_name(), bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
+  fprintf(stderr, "Max clients: %d\n", max_clients);
 
-    /* Wait for events */
-    struct timeval timeout = {
-        .tv_sec = 0,
-        .tv_usec = kSelectTimeoutMs * 1000};
+  EbEvent events[kMaxEvents];
 
-    int ready = select(max_fd + 1, &read_fds, &write_fds, NULL, &timeout);
-    if (ready < 0)
+  /* Main event loop */
+  while (1)
+  {
+    /* Wait for events or the next timer tick */
+    int nev = eb_wait(server->eb, events, kMaxEvents, -1);
+    if (nev < 0)
     {
       if (errno == EINTR)
         continue;
-      perror("select");
+      perror("eb_wait");
       break;
     }
 
-    /* Handle new connections */
-    if (FD_ISSET(server->listen_fd, &read_fds))
+    for (int i = 0; i < nev; i++)
     {
-      accept_new_clients(server);
-    }
+      Client *client = events[i].udata;
+      unsigned ev = events[i].events;
 
-    /* Handle client I/O */
-    for (int i = 0; i < kMaxClients; i++)
-    {
-      Client *client = &server->clients[i];
+      /* Handle new connections */
+      if (!client)
+      {
+        accept_new_clients(server);
+        continue;
+      }
+
+      /* Closed by an earlier event in this batch */
       if (client->fd < 0)
         continue;
 
-      if (FD_ISSET(client->fd, &read_fds))
+      /* Errors surface through recv/send */
+      if (client->state == STATE_READING_REQUEST &&
+          (ev & (kEbRead | kEbError)))
       {
         handle_client_read(server, client);
       }
-
-      if (client->fd >= 0 && FD_ISSET(client->fd, &write_fds))
+      else if (client->state == STATE_SENDING_RESPONSE &&
+               (ev & (kEbWrite | kEbError)))
       {
         handle_client_write(server, client);
       }
+      else if (client->state == STATE_CLOSING &&
+               (ev & (kEbRead | kEbError)))
+      {
+        handle_client_linger(server, client);
+      }
+
+      if (client->fd >= 0)
+        update_interest(server, client);
     }
 
+    /* Reclaim clients whose deadline passed */
+    expire_clients(server);
+
     /* Print statistics periodically */
     static int counter = 0;
     if (++counter % 1000 == 0)
     {
-      fprintf(stderr, "Stats: clients=%d requests=%lu bytes_sent=%lu\n",
-              server->num_clients, server->total_requests, server->total_bytes_sent);
+      fprintf(stderr, "Stats: clients=%d requests=%lu bytes_sent=%lu timeouts=%lu\n",
+              server->num_clients, server->total_requests, server->total_bytes_sent,
+              server->total_timeouts);
     }
   }
 
   /* Cleanup */
   close(server->listen_fd);
-  for (int i = 0; i < kMaxClients; i++)
+  for (int i = 0; i < max_clients; i++)
   {
-    if (server->clients[i].fd >= 0)
-    {
-      close_client(&server->clients[i]);
-    }
+    close_client(server, &server->clients[i]);
+    free(server->clients[i].parser);
   }
+  free(server->clients);
+  eb_destroy(server->eb);
   free(server);
 
   return 0;
 }
 
+/**
+ * Raise the fd limit to fit the client cap
+ */
+static int increase_fd_limit(int max_clients)
+{
+  struct rlimit rlim;
+  rlim_t needed = (rlim_t)max_clients * 2 + 64; /* socket + file per client */
+
+  if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+  {
+    return -1;
+  }
+
+  if (rlim.rlim_cur >= needed)
+  {
+    return 0;
+  }
+
+  rlim.rlim_cur = (rlim.rlim_max == RLIM_INFINITY || rlim.rlim_max > needed)
+                      ? needed
+                      : rlim.rlim_max;
+  if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+  {
+    return -1;
+  }
+
+  return rlim.rlim_cur >= needed ? 0 : -1;
+}
+
 /**
  * Create and configure listening socket
  */
@@ -242,6 +347,9 @@ static int create_listen_socket(const char *bind_addr, int port)
     return -1;
   }
 
+  /* Accepted sockets inherit TCP_NODELAY from the listener */
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &reuse, sizeof(reuse));
+
   /* Set non-blocking mode */
   if (set_nonblock(fd) < 0)
   {
@@ -281,11 +389,8 @@ static void accept_new_clients(Server *server)
 {
   while (1)
   {
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-
-    int client_fd = accept(server->listen_fd,
-                           (struct sockaddr *)&client_addr, &addr_len);
+    /* Non-blocking and TCP_NODELAY come with the socket */
+    int client_fd = accept_nonblock(server->listen_fd);
     if (client_fd < 0)
     {
       if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -296,34 +401,48 @@ static void accept_new_clients(Server *server)
       break;
     }
 
-    /* Find free client slot */
-    Client *client = NULL;
-    for (int i = 0; i < kMaxClients; i++)
+    /* Get client from pool */
+    Client *client = server->free_list;
+    if (!client)
     {
-      if (server->clients[i].fd < 0)
+      fprintf(stderr, "Server full, rejecting connection\n");
+      close(client_fd);
+      continue;
+    }
+
+    /* Allocate request buffer on first use - kept while pooled */
+    if (!client->request_buffer)
+    {
+      client->parser = malloc(sizeof(http_parser_t) + kRequestBufferSize);
+      if (!client->parser)
       {
-        client = &server->clients[i];
-        break;
+        close(client_fd);
+        continue;
       }
+      client->request_buffer = (char *)(client->parser + 1);
     }
+    server->free_list = client->next;
+    client->next = NULL;
 
-    if (!client)
+    /* Add to the readiness set */
+    if (eb_register(server->eb, client_fd, kEbRead, client) < 0)
     {
-      fprintf(stderr, "Server full, rejecting connection\n");
+      perror("eb_register");
       close(client_fd);
+      client->next = server->free_list;
+      server->free_list = client;
       continue;
     }
 
-    /* Configure client socket */
-    set_nonblock(client_fd);
-    int nodelay = 1;
-    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
-
     /* Initialize client */
     reset_client(client);
     client->fd = client_fd;
     client->state = STATE_READING_REQUEST;
+    client->interest = kEbRead;
+    http_parser_init(client->parser);
     server->num_clients++;
+
+    eb_timer_schedule(server->eb, &client->timer, kIdleTimeoutMs);
   }
 }
 
@@ -334,7 +453,7 @@ static void handle_client_read(Server *server, Client *client)
 {
   ssize_t n = recv(client->fd,
                    client->request_buffer + client->request_size,
-                   sizeof(client->request_buffer) - client->request_size - 1, 0);
+                   kRequestBufferSize - client->request_size - 1, 0);
 
   if (n <= 0)
   {
@@ -342,26 +461,106 @@ static void handle_client_read(Server *server, Client *client)
     {
       return; /* Try again later */
     }
-    close_client(client);
-    server->num_clients--;
+    close_client(server, client);
     return;
   }
 
+  /* Header deadline runs from the first byte and is not extended */
+  if (client->request_size == 0)
+  {
+    eb_timer_schedule(server->eb, &client->timer, kHeaderTimeoutMs);
+  }
+
   client->request_size += n;
-  client->request_buffer[client->request_size] = '\0';
+  parse_client_request(server, client);
 
-  /* Check if request is complete */
-  if (strstr(client->request_buffer, "\r\n\r\n"))
+  /*
+   * Optimistic inline write: most responses fit in the socket buffer,
+   * so send now instead of waiting a round-trip for writability.
+   */
+  if (client->fd >= 0 && client->state == STATE_SENDING_RESPONSE)
   {
-    process_http_request(server, client);
-    server->total_requests++;
+    handle_client_write(server, client);
   }
 }
 
+/**
+ * Parse the buffered request bytes, preparing a response once complete
+ */
+static void parse_client_request(Server *server, Client *client)
+{
+  /* Only the new bytes are scanned; a complete header fills parser->req */
+  int parsed = http_parser_execute(client->parser, client->request_buffer,
+                                   client->request_size);
+  if (parsed == 0)
+  {
+    return;
+  }
+
+  if (parsed < 0)
+  {
+    prepare_error_response(server, client, 400); /* Bad Request */
+  }
+  else
+  {
+    /* The last request allowed on this connection says so */
+    client->keep_alive = client->parser->req.keep_alive &&
+                         client->requests + 1 < kKeepAliveMax;
+    process_http_request(server, client, &client->parser->req);
+  }
+  server->total_requests++;
+}
+
 /**
  * Handle client write events
  */
 static void handle_client_write(Server *server, Client *client)
+{
+  /* Pipelined requests are answered back to back while the socket takes them */
+  while (client->state == STATE_SENDING_RESPONSE)
+  {
+    int ret = send_client_response(server, client);
+    if (ret < 0)
+    {
+      close_client(server, client);
+      return;
+    }
+    if (ret == 0)
+    {
+      return; /* Try again later */
+    }
+
+    /* Sent in full: close, or go back to reading */
+    if (!client->keep_alive)
+    {
+      linger_client(server, client);
+      return;
+    }
+    next_client_request(server, client);
+  }
+}
+
+/**
+ * Discard input on a lingering client until the peer closes
+ */
+static void handle_client_linger(Server *server, Client *client)
+{
+  ssize_t n = recv(client->fd, client->request_buffer, kRequestBufferSize, 0);
+
+  if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
+  {
+    return; /* Keep draining until EOF or the linger deadline */
+  }
+  close_client(server, client);
+}
+
+/**
+ * Send the pending header, then file content
+ *
+ * @return 1 once the whole response is out, 0 if the socket pushed
+ *         back, -1 on error
+ */
+static int send_client_response(Server *server, Client *client)
 {
   /* Send from response buffer */
   if (client->response_buffer)
@@ -375,34 +574,30 @@ static void handle_client_write(Server *server, Client *client)
     {
       if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
       {
-        return; /* Try again later */
+        return 0; /* Try again later */
       }
-      close_client(client);
-      server->num_clients--;
-      return;
+      return -1;
     }
 
     client->response_sent += n;
     server->total_bytes_sent += n;
+    eb_timer_schedule(server->eb, &client->timer, kSendTimeoutMs);
 
-    /* Check if response complete */
-    if (client->response_sent >= client->response_size)
+    /* Partial header: wait for writability */
+    if (client->response_sent < client->response_size)
     {
-      free(client->response_buffer);
-      client->response_buffer = NULL;
+      return 0;
+    }
 
-      /* If we have a file to send, continue with that */
-      if (client->file_fd >= 0)
-      {
-        client->state = STATE_SENDING_RESPONSE;
-      }
-      else
-      {
-        close_client(client);
-        server->num_clients--;
-      }
+    free(client->response_buffer);
+    client->response_buffer = NULL;
+
+    if (client->file_fd < 0)
+    {
+      return 1;
     }
-    return;
+
+    /* Header done: go straight on to the first file chunk */
   }
 
   /* Send file content */
@@ -417,17 +612,13 @@ static void handle_client_write(Server *server, Client *client)
 
     if (to_read == 0)
     {
-      close_client(client);
-      server->num_clients--;
-      return;
+      return 1;
     }
 
     ssize_t n = pread(client->file_fd, buffer, to_read, client->file_offset);
     if (n <= 0)
     {
-      close_client(client);
-      server->num_clients--;
-      return;
+      return -1;
     }
 
     ssize_t sent = send(client->fd, buffer, n, MSG_NOSIGNAL);
@@ -435,46 +626,78 @@ static void handle_client_write(Server *server, Client *client)
     {
       if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
       {
-        return; /* Try again later */
+        return 0; /* Try again later */
       }
-      close_client(client);
-      server->num_clients--;
-      return;
+      return -1;
     }
 
     client->file_offset += sent;
     server->total_bytes_sent += sent;
+    eb_timer_schedule(server->eb, &client->timer, kSendTimeoutMs);
 
     /* Check if file transfer complete */
     if (client->file_offset >= client->file_size)
     {
-      close_client(client);
-      server->num_clients--;
+      return 1;
     }
   }
+
+  return 0;
 }
 
 /**
- * Process HTTP request and prepare response
+ * Recycle a keep-alive client once its response is fully sent
+ *
+ * Buffers stay attached. Bytes read past the finished request (a
+ * pipelining client) move to the front and are parsed right away.
  */
-static void process_http_request(Server *server, Client *client)
+static void next_client_request(Server *server, Client *client)
 {
-  http_req_t request;
-  char file_path[kPathBufferSize];
+  if (client->file_fd >= 0)
+  {
+    close(client->file_fd);
+    client->file_fd = -1;
+  }
+
+  size_t used = client->parser->pos;
+  client->request_size -= used;
+  memmove(client->request_buffer, client->request_buffer + used, client->request_size);
+
+  client->state = STATE_READING_REQUEST;
+  client->requests++;
+  client->keep_alive = 0;
+  client->response_size = 0;
+  client->response_sent = 0;
+  client->file_offset = 0;
+  client->file_size = 0;
+  http_parser_init(client->parser);
 
-  /* Parse request */
-  if (http_parse_request(client->request_buffer,
-                         client->request_size, &request) <= 0)
+  if (client->request_size == 0)
   {
-    prepare_error_response(client, 400); /* Bad Request */
+    eb_timer_schedule(server->eb, &client->timer, kKeepAliveTimeoutMs);
     return;
   }
 
+  eb_timer_schedule(server->eb, &client->timer, kHeaderTimeoutMs);
+  parse_client_request(server, client);
+}
+
+
+
+/**
+ * Process HTTP request and prepare response
+ */
+static void process_http_request(Server *server, Client *client,
+                                 const http_req_t *request)
+{
+  char file_path[kPathBufferSize];
+
   /* Build safe file path */
   if (http_safe_join(file_path, sizeof(file_path),
-                     server->doc_root, request.path) < 0)
+                     server->doc_root, client->request_buffer + request->target.off,
+                     request->target.len) < 0)
   {
-    prepare_error_response(client, 404); /* Not Found */
+    prepare_error_response(server, client, 404); /* Not Found */
     return;
   }
 
@@ -482,24 +705,24 @@ static void process_http_request(Server *server, Client *client)
   struct stat st;
   if (stat(file_path, &st) < 0 || !S_ISREG(st.st_mode))
   {
-    prepare_error_response(client, 404); /* Not Found */
+    prepare_error_response(server, client, 404); /* Not Found */
     return;
   }
 
   /* Prepare file response */
-  prepare_file_response(client, file_path);
+  prepare_file_response(server, client, file_path);
 }
 
 /**
  * Prepare file response
  */
-static void prepare_file_response(Client *client, const char *file_path)
+static void prepare_file_response(Server *server, Client *client, const char *file_path)
 {
   /* Open file */
   client->file_fd = open(file_path, O_RDONLY);
   if (client->file_fd < 0)
   {
-    prepare_error_response(client, 500); /* Internal Server Error */
+    prepare_error_response(server, client, 500); /* Internal Server Error */
     return;
   }
 
@@ -509,7 +732,7 @@ static void prepare_file_response(Client *client, const char *file_path)
   {
     close(client->file_fd);
     client->file_fd = -1;
-    prepare_error_response(client, 500);
+    prepare_error_response(server, client, 500);
     return;
   }
 
@@ -518,13 +741,13 @@ static void prepare_file_response(Client *client, const char *file_path)
 
   /* Build HTTP header */
   char header[kHeaderBufferSize];
-  int header_len = http_build_200(header, sizeof(header),
-                                  st.st_size, http_guess_type(file_path));
+  int header_len = http_build_200(header, sizeof(header), st.st_size,
+                                  http_guess_type(file_path), client->keep_alive);
   if (header_len < 0)
   {
     close(client->file_fd);
     client->file_fd = -1;
-    prepare_error_response(client, 500);
+    prepare_error_response(server, client, 500);
     return;
   }
 
@@ -534,7 +757,7 @@ static void prepare_file_response(Client *client, const char *file_path)
   {
     close(client->file_fd);
     client->file_fd = -1;
-    prepare_error_response(client, 500);
+    prepare_error_response(server, client, 500);
     return;
   }
 
@@ -542,16 +765,23 @@ static void prepare_file_response(Client *client, const char *file_path)
   client->response_size = header_len;
   client->response_sent = 0;
   client->state = STATE_SENDING_RESPONSE;
+  eb_timer_schedule(server->eb, &client->timer, kSendTimeoutMs);
 }
 
 /**
  * Prepare error response
  */
-static void prepare_error_response(Client *client, int status_code)
+static void prepare_error_response(Server *server, Client *client, int status_code)
 {
   char response[kHeaderBufferSize];
   int response_len = 0;
 
+  /* Only a 404 leaves the request stream in a known state */
+  if (status_code != 404)
+  {
+    client->keep_alive = 0;
+  }
+
   switch (status_code)
   {
   case 400:
@@ -564,7 +794,7 @@ static void prepare_error_response(Client *client, int status_code)
     break;
 
   case 404:
-    response_len = http_build_404(response, sizeof(response));
+    response_len = http_build_404(response, sizeof(response), client->keep_alive);
     break;
 
   case 500:
@@ -587,7 +817,7 @@ static void prepare_error_response(Client *client, int status_code)
 
   if (response_len <= 0 || (size_t)response_len >= sizeof(response))
   {
-    close_client(client);
+    close_client(server, client);
     return;
   }
 
@@ -595,7 +825,7 @@ static void prepare_error_response(Client *client, int status_code)
   client->response_buffer = malloc(response_len + 1); /* +1 for safety */
   if (!client->response_buffer)
   {
-    close_client(client);
+    close_client(server, client);
     return;
   }
 
@@ -603,17 +833,43 @@ static void prepare_error_response(Client *client, int status_code)
   client->response_size = response_len;
   client->response_sent = 0;
   client->state = STATE_SENDING_RESPONSE;
+  eb_timer_schedule(server->eb, &client->timer, kSendTimeoutMs);
+}
+
+/**
+ * Keep registered interest in sync with the state machine
+ */
+static void update_interest(Server *server, Client *client)
+{
+  unsigned wanted = (client->state == STATE_SENDING_RESPONSE) ? kEbWrite : kEbRead;
+
+  if (wanted == client->interest)
+  {
+    return;
+  }
+
+  if (eb_modify(server->eb, client->fd, wanted, client) < 0)
+  {
+    close_client(server, client);
+    return;
+  }
+  client->interest = wanted;
 }
 
 /**
- * Close client connection and free resources
+ * Close after the final response without losing it to a RST
+ *
+ * Closing with unread input (pipelined requests past the last one, or the
+ * rest of a bad request) makes the kernel reset the connection, and the
+ * client may drop the response it has not read yet. Send FIN instead and
+ * discard input until the client closes or kLingerTimeoutMs passes.
  */
-static void close_client(Client *client)
+static void linger_client(Server *server, Client *client)
 {
-  if (client->fd >= 0)
+  if (shutdown(client->fd, SHUT_WR) < 0)
   {
-    close(client->fd);
-    client->fd = -1;
+    close_client(server, client);
+    return;
   }
 
   if (client->file_fd >= 0)
@@ -622,6 +878,30 @@ static void close_client(Client *client)
     client->file_fd = -1;
   }
 
+  client->state = STATE_CLOSING;
+  client->request_size = 0;
+  eb_timer_schedule(server->eb, &client->timer, kLingerTimeoutMs);
+}
+
+/**
+ * Close client connection, free resources and return it to the pool
+ */
+static void close_client(Server *server, Client *client)
+{
+  if (client->fd < 0)
+  {
+    return;
+  }
+
+  eb_close(server->eb, client->fd);
+  eb_timer_cancel(server->eb, &client->timer);
+
+  if (client->file_fd >= 0)
+  {
+    close(client->file_fd);
+    client->file_fd = -1;
+  }
+
   if (client->response_buffer)
   {
     free(client->response_buffer);
@@ -629,6 +909,30 @@ static void close_client(Client *client)
   }
 
   reset_client(client);
+  client->next = server->free_list;
+  server->free_list = client;
+  server->num_clients--;
+}
+
+/**
+ * Close every client whose deadline has passed, in one batch
+ */
+static void expire_clients(Server *server)
+{
+  TimerNode expired;
+  timer_wheel_list_init(&expired);
+
+  if (eb_expire(server->eb, &expired) == 0)
+  {
+    return;
+  }
+
+  TimerNode *node;
+  while ((node = timer_wheel_list_pop(&expired)) != NULL)
+  {
+    server->total_timeouts++;
+    close_client(server, timer_entry(node, Client, timer));
+  }
 }
 
 /**
@@ -638,12 +942,14 @@ static void reset_client(Client *client)
 {
   client->fd = -1;
   client->state = STATE_READING_REQUEST;
+  client->interest = 0;
   client->request_size = 0;
+  client->keep_alive = 0;
+  client->requests = 0;
   client->response_buffer = NULL;
   client->response_size = 0;
   client->response_sent = 0;
   client->file_fd = -1;
   client->file_offset = 0;
   client->file_size = 0;
-  memset(client->request_buffer, 0, sizeof(client->request_buffer));
-}
\ No newline at end of file
+}
@@ -4,7 +4,7 @@
 /**
  * Asynchronous I/O HTTP Server
  * 
- * Event-driven server using select() for multiplexed I/O.
+ * Event-driven server using poll() for multiplexed I/O.
  * Handles multiple concurrent connections without threads.
  */
 
@@ -18,4 +18,16 @@
  */
 int run_aio_server(const char *bind_addr, int port, const char *doc_root);
 
+/**
+ * Starts the async I/O HTTP server with a custom client cap
+ *
+ * @param bind_addr   IP address to bind (NULL for INADDR_ANY)
+ * @param port        Port number to listen on
+ * @param doc_root    Document root directory path
+ * @param max_clients Maximum concurrent clients (not bound by FD_SETSIZE)
+ * @return            0 on success, -1 on failure
+ */
+int run_aio_server_clients(const char *bind_addr, int port,
+                           const char *doc_root, int max_clients);
+
 #endif /* AIO_SERVER_H */
\ No newline at end of file
@@ -0,0 +1,217 @@
+/**
+ * Request parsing microbenchmark (make bench)
+ *
+ * Times the strstr/strchr parser the servers used before the incremental
+ * parser, including the strstr keep-alive probes they ran on top of it,
+ * against http_parser_execute() with every scan kernel this CPU runs.
+ * Each request is parsed whole, then again as it arrives in 64-byte
+ * reads, where the old code rescanned the buffer after every read.
+ */
+#include "../common/http.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum
+{
+    kIterations = 200000,
+    kChunkSize = 64,
+};
+
+static const char *const kRequests[] = {
+    /* wrk / curl */
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "\r\n",
+
+    /* Browser */
+    "GET /static/js/app.bundle.min.js?v=20240611 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/126.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+    "*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9,ko;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: https://www.example.com/products/category/shoes?page=2&sort=price\r\n"
+    "Cookie: session=3f2a9c1e7b5d4a6f8e0c2b4d6f8a0c2e; theme=dark; consent=1; "
+    "_ga=GA1.2.1234567890.1700000000\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+};
+
+/* http_req_t before the request view */
+typedef struct
+{
+    char method[8];
+    char path[1024];
+    int complete;
+    int keep_alive;
+} LegacyRequest;
+
+/* Keep the compiler from dropping a result nobody reads */
+#define KEEP(ptr) __asm__ volatile("" : : "r"(ptr) : "memory")
+
+/* http_parse_request() before the incremental parser */
+static int legacy_parse(char *buf, size_t len, LegacyRequest *out)
+{
+    if (!buf || !out || len == 0) {
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+
+    char *header_end = strstr(buf, "\r\n\r\n");
+    if (!header_end) {
+        return 0;
+    }
+
+    out->complete = 1;
+
+    if (len < 14 || strncmp(buf, "GET ", 4) != 0) {
+        return -1;
+    }
+
+    strncpy(out->method, "GET", sizeof(out->method) - 1);
+    out->method[sizeof(out->method) - 1] = '\0';
+
+    char *path_start = buf + 4;
+    while (path_start < header_end && *path_start == ' ') {
+        path_start++;
+    }
+
+    if (path_start >= header_end) {
+        return -1;
+    }
+
+    char *path_end = strchr(path_start, ' ');
+    if (!path_end || path_end > header_end) {
+        return -1;
+    }
+
+    size_t path_len = path_end - path_start;
+    if (path_len == 0 || path_len >= sizeof(out->path)) {
+        return -1;
+    }
+
+    memcpy(out->path, path_start, path_len);
+    out->path[path_len] = '\0';
+
+    if (strcmp(out->path, "/") == 0) {
+        strcpy(out->path, "/index.html");
+    }
+
+    out->keep_alive = strstr(buf, "Connection: keep-alive") != NULL ||
+                      strstr(buf, "HTTP/1.1") != NULL;
+    return 1;
+}
+
+/* Old read loop: NUL-terminate and rescan from the start after each read */
+static int legacy_request(char *buf, const char *request, size_t len, size_t chunk)
+{
+    LegacyRequest out;
+    size_t have = 0;
+
+    while (have < len) {
+        size_t n = len - have < chunk ? len - have : chunk;
+        memcpy(buf + have, request + have, n);
+        have += n;
+        buf[have] = '\0';
+        if (strstr(buf, "\r\n\r\n")) {
+            int ret = legacy_parse(buf, have, &out);
+            KEEP(&out);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* New read loop: the parser picks up where the previous read ended */
+static int parser_request(char *buf, const char *request, size_t len, size_t chunk)
+{
+    http_parser_t parser;
+    size_t have = 0;
+
+    http_parser_init(&parser);
+    while (have < len) {
+        size_t n = len - have < chunk ? len - have : chunk;
+        memcpy(buf + have, request + have, n);
+        have += n;
+        int ret = http_parser_execute(&parser, buf, have);
+        if (ret != 0) {
+            KEEP(&parser.req);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+typedef int (*RequestFn)(char *buf, const char *request, size_t len, size_t chunk);
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Nanoseconds per request, best of three runs */
+static double time_request(RequestFn fn, const char *request, size_t chunk)
+{
+    static char buf[8192];
+    size_t len = strlen(request);
+    double best = 0;
+
+    for (int run = 0; run < 3; run++) {
+        double start = now_ns();
+        for (int i = 0; i < kIterations; i++) {
+            if (fn(buf, request, len, chunk) != 1) {
+                fprintf(stderr, "parse failed\n");
+                exit(1);
+            }
+        }
+        double ns = (now_ns() - start) / kIterations;
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(void)
+{
+    static const char *const kKernels[] = {"avx2", "sse4.2", "sse2", "scalar"};
+    const char *chosen = http_scan_kernel();
+
+    printf("scan kernel at startup: %s\n\n", chosen);
+    printf("%-8s %-16s %12s %12s\n", "request", "parser", "whole (ns)", "64B reads");
+
+    for (size_t r = 0; r < sizeof(kRequests) / sizeof(kRequests[0]); r++) {
+        const char *request = kRequests[r];
+        size_t len = strlen(request);
+        char label[16];
+
+        snprintf(label, sizeof(label), "%zuB", len);
+        printf("%-8s %-16s %12.1f %12.1f\n", label, "strstr (old)",
+               time_request(legacy_request, request, len),
+               time_request(legacy_request, request, kChunkSize));
+
+        for (size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); k++) {
+            if (http_scan_use(kKernels[k]) < 0) {
+                continue;
+            }
+            char name[24];
+            snprintf(name, sizeof(name), "parser/%s", kKernels[k]);
+            printf("%-8s %-16s %12.1f %12.1f\n", label, name,
+                   time_request(parser_request, request, len),
+                   time_request(parser_request, request, kChunkSize));
+        }
+    }
+
+    http_scan_use(chosen);
+    return 0;
+}
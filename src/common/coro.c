@@ -0,0 +1,228 @@
+#if defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE /* MAP_ANON */
+#endif
+
+#include "coro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define CORO_CANARY ((uintptr_t)0x5ca1ab1ec0ffee11ULL)
+
+#ifdef __APPLE__
+#define CORO_SYM(name) "_" #name
+#else
+#define CORO_SYM(name) #name
+#endif
+
+#ifdef CORO_ASM
+/* Entered by the first switch into a context; fn and arg ride in callee-saved registers */
+void coro_trampoline(void);
+
+#if defined(__x86_64__)
+__asm__(
+    ".text\n"
+    ".globl " CORO_SYM(coro_switch) "\n"
+    ".globl " CORO_SYM(coro_trampoline) "\n"
+    ".p2align 4\n"
+    CORO_SYM(coro_switch) ":\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq (%rsi), %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    CORO_SYM(coro_trampoline) ":\n"
+    "    movq %r13, %rdi\n"
+    "    callq *%r12\n"
+    "    ud2\n");
+
+/* Saved frame, lowest address first: r15 r14 r13 r12 rbx rbp, return address */
+enum
+{
+    kFrameWords = 7,
+    kFrameArg = 2,
+    kFrameFn = 3,
+    kFrameReturn = 6,
+};
+#elif defined(__aarch64__)
+__asm__(
+    ".text\n"
+    ".globl " CORO_SYM(coro_switch) "\n"
+    ".globl " CORO_SYM(coro_trampoline) "\n"
+    ".p2align 4\n"
+    CORO_SYM(coro_switch) ":\n"
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    ldr x9, [x1]\n"
+    "    mov sp, x9\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    CORO_SYM(coro_trampoline) ":\n"
+    "    mov x0, x20\n"
+    "    blr x19\n"
+    "    brk #0\n");
+
+/* Saved frame: x19-x30 then d8-d15, 16-byte aligned; x30 is the return address */
+enum
+{
+    kFrameWords = 22,
+    kFrameFn = 0,
+    kFrameArg = 1,
+    kFrameReturn = 11,
+};
+#endif
+
+void coro_make(CoroContext *ctx, void *stack, size_t stack_size, CoroFn fn, void *arg)
+{
+    uintptr_t top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)15;
+
+#if defined(__x86_64__)
+    /* After the pops and ret rsp is 16-aligned, so fn starts as if called */
+    uintptr_t *frame = (uintptr_t *)(top - 16) - kFrameWords;
+#else
+    uintptr_t *frame = (uintptr_t *)top - kFrameWords;
+#endif
+
+    for (int i = 0; i < kFrameWords; i++) {
+        frame[i] = 0;
+    }
+    frame[kFrameFn] = (uintptr_t)fn;
+    frame[kFrameArg] = (uintptr_t)arg;
+    frame[kFrameReturn] = (uintptr_t)coro_trampoline;
+    ctx->sp = frame;
+}
+#else
+static void coro_entry(unsigned hi, unsigned lo)
+{
+    CoroContext *ctx = (CoroContext *)(uintptr_t)(((uint64_t)hi << 32) | lo);
+    ctx->fn(ctx->arg);
+    abort(); /* fn must switch away instead of returning */
+}
+
+void coro_make(CoroContext *ctx, void *stack, size_t stack_size, CoroFn fn, void *arg)
+{
+    /* makecontext() only passes ints: split the context pointer */
+    uint64_t self = (uint64_t)(uintptr_t)ctx;
+
+    ctx->fn = fn;
+    ctx->arg = arg;
+    getcontext(&ctx->uc);
+    ctx->uc.uc_stack.ss_sp = stack;
+    ctx->uc.uc_stack.ss_size = stack_size;
+    ctx->uc.uc_link = NULL;
+    makecontext(&ctx->uc, (void (*)(void))coro_entry, 2,
+                (unsigned)(self >> 32), (unsigned)self);
+}
+
+void coro_switch(CoroContext *from, CoroContext *to)
+{
+    swapcontext(&from->uc, &to->uc);
+}
+#endif
+
+void coro_stack_pool_init(CoroStackPool *pool, size_t stack_size)
+{
+    pool->stack_size = stack_size;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+    pool->slabs = NULL;
+    pool->num_slabs = 0;
+    pool->slab_capacity = 0;
+}
+
+void coro_stack_pool_destroy(CoroStackPool *pool)
+{
+    for (size_t i = 0; i < pool->num_slabs; i++) {
+        munmap(pool->slabs[i], pool->stack_size * kCoroStacksPerSlab);
+    }
+    free(pool->slabs);
+    coro_stack_pool_init(pool, pool->stack_size);
+}
+
+/**
+ * Map one slab and put its stacks on the free list
+ */
+static int add_slab(CoroStackPool *pool)
+{
+    if (pool->num_slabs == pool->slab_capacity) {
+        size_t capacity = pool->slab_capacity ? pool->slab_capacity * 2 : 16;
+        void **grown = realloc(pool->slabs, capacity * sizeof(*grown));
+        if (!grown) {
+            return -1;
+        }
+        pool->slabs = grown;
+        pool->slab_capacity = capacity;
+    }
+
+    /* Pages are only backed once a coroutine touches them */
+    char *slab = mmap(NULL, pool->stack_size * kCoroStacksPerSlab, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (slab == MAP_FAILED) {
+        return -1;
+    }
+    pool->slabs[pool->num_slabs++] = slab;
+
+    for (int i = kCoroStacksPerSlab - 1; i >= 0; i--) {
+        void **stack = (void **)(slab + (size_t)i * pool->stack_size);
+        *stack = pool->free_list;
+        pool->free_list = stack;
+    }
+    return 0;
+}
+
+void *coro_stack_alloc(CoroStackPool *pool)
+{
+    if (!pool->free_list && add_slab(pool) < 0) {
+        return NULL;
+    }
+
+    void **stack = pool->free_list;
+    pool->free_list = *stack;
+    *(uintptr_t *)stack = CORO_CANARY;
+    pool->in_use++;
+    return stack;
+}
+
+void coro_stack_free(CoroStackPool *pool, void *stack)
+{
+    /* Overflow ran into the next stack down: nothing left to trust */
+    if (*(uintptr_t *)stack != CORO_CANARY) {
+        fprintf(stderr, "coroutine stack overflow (%zu bytes)\n", pool->stack_size);
+        abort();
+    }
+
+    *(void **)stack = pool->free_list;
+    pool->free_list = stack;
+    pool->in_use--;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Stackful coroutines for blocking-style handlers on an event loop.
+ *
+ * coro_switch() saves the callee-saved registers on the current stack
+ * and swaps stack pointers, so a switch costs a few dozen instructions
+ * and no syscall. Hand-written for x86-64 and AArch64; other targets
+ * (or -DCORO_USE_UCONTEXT) fall back to swapcontext(), which also
+ * saves the signal mask with a syscall per switch.
+ *
+ * Stacks come from a pool of slabs, one mapping per kCoroStacksPerSlab
+ * stacks, so 100K coroutines do not run into vm.max_map_count. There
+ * are no guard pages between them; a canary at the bottom of each stack
+ * is checked when it is returned to the pool instead.
+ */
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && !defined(CORO_USE_UCONTEXT)
+#define CORO_ASM 1
+#else
+#include <ucontext.h>
+#endif
+
+enum
+{
+    kCoroStacksPerSlab = 64,
+};
+
+typedef void (*CoroFn)(void *arg);
+
+typedef struct
+{
+#ifdef CORO_ASM
+    void *sp; /* Saved stack pointer while switched out */
+#else
+    ucontext_t uc;
+    CoroFn fn;
+    void *arg;
+#endif
+} CoroContext;
+
+typedef struct
+{
+    size_t stack_size;
+    void *free_list; /* Free stacks, linked through their lowest word */
+    size_t in_use;
+    void **slabs;
+    size_t num_slabs;
+    size_t slab_capacity;
+} CoroStackPool;
+
+/**
+ * @brief Initialize an empty pool of stack_size stacks (page multiple)
+ */
+void coro_stack_pool_init(CoroStackPool *pool, size_t stack_size);
+
+/**
+ * @brief Unmap every slab; stacks still in use become invalid
+ */
+void coro_stack_pool_destroy(CoroStackPool *pool);
+
+/**
+ * @brief Take a stack, mapping a new slab if the pool is empty
+ * @return Lowest address of the stack, or NULL on failure (errno set)
+ */
+void *coro_stack_alloc(CoroStackPool *pool);
+
+/**
+ * @brief Return a stack to the pool; aborts if its canary was overwritten
+ */
+void coro_stack_free(CoroStackPool *pool, void *stack);
+
+/**
+ * @brief Prepare ctx to run fn(arg) on stack at its first coro_switch()
+ *
+ * fn must never return; it ends by switching away for good.
+ */
+void coro_make(CoroContext *ctx, void *stack, size_t stack_size, CoroFn fn, void *arg);
+
+/**
+ * @brief Save the running context into from and resume to
+ */
+void coro_switch(CoroContext *from, CoroContext *to);
@@ -6,56 +6,711 @@
 #include <stdlib.h>
 #include <limits.h>
 
-int http_parse_request(char *buf, size_t len, http_req_t *out)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HTTP_SCAN_X86 1
+#endif
+
+/* 파서 상태: 요청 줄, 헤더 줄, 빈 줄 순서로 진행 */
+enum {
+    kParseMethod,
+    kParsePathStart,
+    kParsePath,
+    kParseVersion,
+    kParseLineLf,
+    kParseHeaderStart,
+    kParseHeaderName,
+    kParseValueStart,
+    kParseValue,
+    kParseFinalLf,
+};
+
+enum {
+    kFlagClose = 1 << 0,
+    kFlagKeepAlive = 1 << 1,
+};
+
+/* http_req_t.known 순서 */
+static const char *const kKnownHeaders[kHttpKnownHeaders] = {
+    "host", "connection", "if-none-match", "range", "accept-encoding",
+};
+
+/* 이름 길이가 모두 달라서 길이만으로 후보가 하나로 정해진다 (id + 1, 0 = 없음) */
+static const signed char kKnownByLength[16] = {
+    [4] = kHttpHost + 1,
+    [5] = kHttpRange + 1,
+    [10] = kHttpConnection + 1,
+    [13] = kHttpIfNoneMatch + 1,
+    [15] = kHttpAcceptEncoding + 1,
+};
+
+/*
+ * 구분자 스캔 커널: buf[i, len)에서 a, b, c 중 하나가 처음 나오는 위치, 없으면 len.
+ * 경로, 관심 없는 헤더 이름과 값은 이것으로 한 번에 건너뛴다.
+ */
+typedef size_t (*scan_fn)(const char *buf, size_t i, size_t len, char a, char b, char c);
+
+static inline size_t scan_scalar(const char *buf, size_t i, size_t len, char a, char b, char c)
 {
-    if (!buf || !out || len == 0) {
-        return -1;
+    for (; i < len; i++) {
+        char ch = buf[i];
+        if (ch == a || ch == b || ch == c) {
+            break;
+        }
     }
-    
-    memset(out, 0, sizeof(*out));
-    
-    char *header_end = strstr(buf, "\r\n\r\n");
-    if (!header_end) {
+    return i;
+}
+
+#ifdef HTTP_SCAN_X86
+/* x86-64 기본 명령어: 16바이트씩 세 번 비교 */
+static inline size_t scan_sse2(const char *buf, size_t i, size_t len, char a, char b, char c)
+{
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                   _mm_cmpeq_epi8(v, vc));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return scan_scalar(buf, i, len, a, b, c);
+}
+
+/* SSE4.2 문자열 명령어: 구분자 집합을 한 명령으로 비교 */
+__attribute__((target("sse4.2")))
+static inline size_t scan_sse42(const char *buf, size_t i, size_t len, char a, char b, char c)
+{
+    const __m128i set = _mm_setr_epi8(a, b, c, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+        int idx = _mm_cmpestri(set, 3, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+        if (idx < 16) {
+            return i + (size_t)idx;
+        }
+    }
+    return scan_scalar(buf, i, len, a, b, c);
+}
+
+/* AVX2: 32바이트씩 */
+__attribute__((target("avx2")))
+static inline size_t scan_avx2(const char *buf, size_t i, size_t len, char a, char b, char c)
+{
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                                      _mm256_cmpeq_epi8(v, vb)),
+                                      _mm256_cmpeq_epi8(v, vc));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask) {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+    /* AVX2 파서 안으로 인라인되므로 남은 16바이트 단위도 VEX 인코딩이다 */
+    return scan_sse2(buf, i, len, a, b, c);
+}
+#endif
+
+/*
+ * 블록 마스크 커널: 64바이트 p에서 CR/LF 위치를 비트로 돌려주고 ':' 위치는
+ * *colon에. 헤더 줄은 줄마다 스캔을 새로 시작하는 대신 이 마스크를 따라간다.
+ */
+typedef uint64_t (*mask_fn)(const char *p, uint64_t *colon);
+
+/* 8바이트 워드에서 ch와 같은 바이트의 최상위 비트 (자리올림 없이 정확히) */
+static inline uint64_t swar_eq(uint64_t w, unsigned char ch)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t x = w ^ (0x0101010101010101ULL * ch);
+    return ~(((x & low7) + low7) | x) & ~low7;
+}
+
+/* 바이트마다 최상위 비트 하나를 8비트로 모은다 */
+static inline uint64_t swar_pack(uint64_t hi)
+{
+    return ((hi >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+/* 벡터 명령이 없으면 8바이트씩 (SWAR) */
+static inline uint64_t mask_scalar(const char *p, uint64_t *colon)
+{
+    uint64_t eol = 0, col = 0;
+
+    for (int k = 0; k < 64; k += 8) {
+        uint64_t w;
+        memcpy(&w, p + k, sizeof(w));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        w = __builtin_bswap64(w);
+#endif
+        eol |= swar_pack(swar_eq(w, '\r') | swar_eq(w, '\n')) << k;
+        col |= swar_pack(swar_eq(w, ':')) << k;
+    }
+    *colon = col;
+    return eol;
+}
+
+#ifdef HTTP_SCAN_X86
+static inline uint64_t mask_sse2(const char *p, uint64_t *colon)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i co = _mm_set1_epi8(':');
+    uint64_t eol = 0, col = 0;
+
+    for (int k = 0; k < 64; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + k));
+        eol |= (uint64_t)(unsigned)_mm_movemask_epi8(
+                   _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf))) << k;
+        col |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, co)) << k;
+    }
+    *colon = col;
+    return eol;
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t mask_avx2(const char *p, uint64_t *colon)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i co = _mm256_set1_epi8(':');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+    uint64_t eol_lo = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(lo, cr), _mm256_cmpeq_epi8(lo, lf)));
+    uint64_t eol_hi = (uint32_t)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(hi, cr), _mm256_cmpeq_epi8(hi, lf)));
+    *colon = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, co)) |
+             (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, co)) << 32;
+    return eol_lo | eol_hi << 32;
+}
+#endif
+
+/* ASCII 대소문자 무시 비교. strncasecmp()는 로캘을 거쳐 헤더마다 부르기엔 느리다 */
+static int ascii_case_eq(const char *a, const char *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        unsigned char x = (unsigned char)a[i], y = (unsigned char)b[i];
+        if (x != y && ((x | 0x20) != (y | 0x20) || (unsigned char)((x | 0x20) - 'a') > 'z' - 'a')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * 소문자와 '-'로만 된 lower와 대소문자 무시 비교. | 0x20이 그런 글자로
+ * 잘못 바꾸는 바이트는 '\r'뿐인데 헤더 이름과 값에는 CR이 없다.
+ * 4~16바이트는 앞뒤 워드를 겹쳐 읽어 글자마다 분기하지 않는다.
+ */
+static inline uint64_t load64(const char *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline uint32_t load32(const char *p)
+{
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline int lower_eq(const char *a, const char *lower, size_t n)
+{
+    if (n >= 8 && n <= 16) {
+        const uint64_t up = 0x2020202020202020ULL;
+        return (((load64(a) | up) ^ load64(lower)) |
+                ((load64(a + n - 8) | up) ^ load64(lower + n - 8))) == 0;
+    }
+    if (n >= 4 && n < 8) {
+        const uint32_t up = 0x20202020U;
+        return (((load32(a) | up) ^ load32(lower)) |
+                ((load32(a + n - 4) | up) ^ load32(lower + n - 4))) == 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (((unsigned char)a[i] | 0x20) != (unsigned char)lower[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static http_slice_t slice(size_t off, size_t len)
+{
+    http_slice_t s = {(uint16_t)off, (uint16_t)len};
+    return s;
+}
+
+/* Connection 값의 토큰 목록에서 close/keep-alive */
+static unsigned connection_flags(const char *v, size_t len)
+{
+    unsigned flags = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        while (i < len && (v[i] == ',' || v[i] == ' ' || v[i] == '\t')) {
+            i++;
+        }
+        size_t start = i;
+        while (i < len && v[i] != ',' && v[i] != ' ' && v[i] != '\t') {
+            i++;
+        }
+        if (i - start == 5 && lower_eq(v + start, "close", 5)) {
+            flags |= kFlagClose;
+        } else if (i - start == 10 && lower_eq(v + start, "keep-alive", 10)) {
+            flags |= kFlagKeepAlive;
+        }
+    }
+    return flags;
+}
+
+/* 표의 n번째 헤더가 자주 보는 헤더면 색인, Connection이면 값도 본다 */
+static inline void index_header(http_parser_t *p, const char *buf, const http_header_t *h, unsigned n)
+{
+    http_req_t *req = &p->req;
+    int k = h->name.len < sizeof(kKnownByLength) ? kKnownByLength[h->name.len] - 1 : -1;
+
+    if (k >= 0 && lower_eq(buf + h->name.off, kKnownHeaders[k], h->name.len)) {
+        if (req->known[k] < 0) {
+            req->known[k] = (int8_t)n;
+        }
+        if (k == kHttpConnection) {
+            p->flags |= connection_flags(buf + h->value.off, h->value.len);
+        }
+    }
+}
+
+void http_parser_init(http_parser_t *p)
+{
+    p->pos = 0;
+    p->state = kParseMethod;
+    p->flags = 0;
+    p->req.num_headers = 0;
+    p->req.complete = 0;
+    p->req.keep_alive = 0;
+    memset(p->req.known, -1, sizeof(p->req.known));
+}
+
+/*
+ * buf[base, len)의 블록 마스크. 64바이트가 안 남았으면 버퍼 끝 64바이트를
+ * 읽고 밀어서 맞춘다 (버퍼 밖은 읽지 않는다). 버퍼가 64바이트보다 짧으면 0.
+ */
+static inline __attribute__((always_inline))
+int load_block(const char *buf, size_t base, size_t len, mask_fn mask, uint64_t *eol, uint64_t *colon)
+{
+    if (len - base >= 64) {
+        *eol = mask(buf + base, colon);
+        return 1;
+    }
+    if (len < 64) {
         return 0;
     }
-    
-    out->complete = 1;
-    
-    if (len < 14 || strncmp(buf, "GET ", 4) != 0) {
-        return -1;
+    unsigned shift = (unsigned)(base - (len - 64));
+    *eol = mask(buf + len - 64, colon) >> shift;
+    *colon >>= shift;
+    return 1;
+}
+
+/*
+ * 줄 끝(CRLF)까지 들어온 헤더 줄을 블록 마스크로 상태 전이 없이 처리한다.
+ * 짧은 줄 여럿이 블록 하나를 나눠 쓰고, 줄마다 스캔을 새로 시작하지 않는다.
+ * 빈 줄이나 덜 들어온 줄에서 그 줄의 시작 위치를 돌려주고 나머지는 상태
+ * 기계가 이어받는다. 에러면 SIZE_MAX.
+ */
+static inline __attribute__((always_inline))
+size_t parse_header_lines(http_parser_t *p, const char *buf, size_t i, size_t len, mask_fn mask)
+{
+    http_req_t *req = &p->req;
+    unsigned n = req->num_headers; /* uint8_t라 표에 쓸 때마다 다시 읽히지 않도록 */
+    size_t base = i;
+    uint64_t colon, eol;
+
+    if (!load_block(buf, base, len, mask, &eol, &colon)) {
+        return i;
     }
-    
-    strncpy(out->method, "GET", sizeof(out->method) - 1);
-    out->method[sizeof(out->method) - 1] = '\0';
-    
-    char *path_start = buf + 4;
-    /* Skip spaces with bounds checking */
-    while (path_start < header_end && *path_start == ' ') {
-        path_start++;
+
+    /* 줄 시작 i는 늘 읽어 둔 블록 [base, base + 64) 안이다 */
+    while (i < len && buf[i] != '\r') {
+        if (buf[i] == '\n' || buf[i] == ':' || n == kHttpMaxHeaders) {
+            return SIZE_MAX;
+        }
+
+        /* 첫 ':'와 첫 CR/LF, 줄이 블록을 넘으면 다음 블록에서 이어서 */
+        size_t line = i, name_end = SIZE_MAX, end;
+        while (1) {
+            uint64_t from = ~0ULL << (i - base);
+            if (name_end == SIZE_MAX && (colon & from)) {
+                name_end = base + (size_t)__builtin_ctzll(colon & from);
+            }
+            if (eol & from) {
+                end = base + (size_t)__builtin_ctzll(eol & from);
+                break;
+            }
+            base += 64;
+            i = base;
+            if (base >= len) {
+                req->num_headers = (uint8_t)n; /* 줄 끝이 아직 안 들어왔다 */
+                return line;
+            }
+            load_block(buf, base, len, mask, &eol, &colon);
+        }
+
+        /* 이름 안에 CR/LF가 있거나 줄 끝이 CRLF가 아니다 */
+        if (name_end > end || buf[end] != '\r') {
+            return SIZE_MAX;
+        }
+        if (end + 1 == len) {
+            req->num_headers = (uint8_t)n; /* LF가 아직 안 들어왔다 */
+            return line;
+        }
+        if (buf[end + 1] != '\n') {
+            return SIZE_MAX;
+        }
+
+        /* 값은 앞뒤 공백 제외 */
+        size_t v = name_end + 1, v_end = end;
+        while (v < end && (buf[v] == ' ' || buf[v] == '\t')) {
+            v++;
+        }
+        while (v_end > v && (buf[v_end - 1] == ' ' || buf[v_end - 1] == '\t')) {
+            v_end--;
+        }
+
+        http_header_t *h = &req->headers[n];
+        h->name = slice(line, name_end - line);
+        h->value = slice(v, v_end - v);
+        index_header(p, buf, h, n);
+        n++;
+
+        i = end + 2;
+        if (i - base >= 64 && i < len) {
+            base = i;
+            load_block(buf, base, len, mask, &eol, &colon);
+        }
     }
-    
-    if (path_start >= header_end) {
+
+    req->num_headers = (uint8_t)n;
+    return i;
+}
+
+/*
+ * 파서 본체. 커널마다 따로 컴파일해 스캔이 인라인되고 비교 벡터를
+ * 호출마다 다시 만들지 않는다.
+ */
+static inline __attribute__((always_inline))
+int parse_execute(http_parser_t *p, const char *buf, size_t len, scan_fn scan, mask_fn mask)
+{
+    http_req_t *req = &p->req;
+    int state = p->state;
+    size_t i = p->pos;
+
+    while (i < len) {
+        unsigned char c = (unsigned char)buf[i];
+        http_header_t *h = &req->headers[req->num_headers];
+
+        switch (state) {
+        case kParseMethod:
+            if (c != ' ' && c != '\r' && c != '\n') {
+                i = scan(buf, i + 1, len, ' ', '\r', '\n');
+                continue;
+            }
+            /* 지금은 GET만 처리한다 */
+            if (c != ' ' || i != 3 || memcmp(buf, "GET", 3) != 0) {
+                return -1;
+            }
+            req->method = slice(0, i);
+            state = kParsePathStart;
+            break;
+
+        case kParsePathStart:
+            if (c == ' ') {
+                break;
+            }
+            if (c == '\r' || c == '\n') {
+                return -1;
+            }
+            req->target.off = (uint16_t)i;
+            state = kParsePath;
+            /* fall through */
+
+        case kParsePath:
+            if (c != ' ' && c != '\r' && c != '\n') {
+                /* 경로 끝까지 한 번에 */
+                i = scan(buf, i + 1, len, ' ', '\r', '\n');
+                continue;
+            }
+            if (c != ' ') {
+                return -1;
+            }
+            req->target.len = (uint16_t)(i - req->target.off);
+            req->version.off = (uint16_t)(i + 1);
+            state = kParseVersion;
+            break;
+
+        case kParseVersion:
+            if (c != '\r' && c != '\n') {
+                i = scan(buf, i + 1, len, '\r', '\n', '\r');
+                continue;
+            }
+            if (c != '\r') {
+                return -1;
+            }
+            req->version.len = (uint16_t)(i - req->version.off);
+            state = kParseLineLf;
+            break;
+
+        case kParseLineLf:
+            if (c != '\n') {
+                return -1;
+            }
+            state = kParseHeaderStart;
+            break;
+
+        case kParseHeaderStart:
+            /* 다 들어온 줄은 한꺼번에, 나머지 한 줄만 아래에서 */
+            i = parse_header_lines(p, buf, i, len, mask);
+            if (i == SIZE_MAX) {
+                return -1;
+            }
+            if (i == len) {
+                continue;
+            }
+            c = (unsigned char)buf[i];
+            h = &req->headers[req->num_headers];
+            if (c == '\r') {
+                state = kParseFinalLf;
+                break;
+            }
+            if (c == '\n' || c == ':' || req->num_headers == kHttpMaxHeaders) {
+                return -1;
+            }
+            h->name.off = (uint16_t)i;
+            state = kParseHeaderName;
+            /* fall through */
+
+        case kParseHeaderName:
+            if (c != ':' && c != '\r' && c != '\n') {
+                i = scan(buf, i + 1, len, ':', '\r', '\n');
+                continue;
+            }
+            if (c != ':') {
+                return -1;
+            }
+            h->name.len = (uint16_t)(i - h->name.off);
+
+            /* 앞 공백을 건너뛰고 바로 값 끝까지 */
+            do {
+                i++;
+            } while (i < len && (buf[i] == ' ' || buf[i] == '\t'));
+            if (i == len) {
+                state = kParseValueStart;
+                continue;
+            }
+            h->value.off = (uint16_t)i;
+            i = scan(buf, i, len, '\r', '\n', '\r');
+            state = kParseValue;
+            continue;
+
+        case kParseValueStart:
+            if (c == ' ' || c == '\t') {
+                break;
+            }
+            h->value.off = (uint16_t)i;
+            state = kParseValue;
+            /* fall through */
+
+        case kParseValue:
+            if (c != '\r' && c != '\n') {
+                /* 값은 줄 끝까지 한 번에 */
+                i = scan(buf, i + 1, len, '\r', '\n', '\r');
+                continue;
+            }
+            if (c != '\r') {
+                return -1;
+            }
+            {
+                size_t end = i;
+                while (end > h->value.off && (buf[end - 1] == ' ' || buf[end - 1] == '\t')) {
+                    end--;
+                }
+                h->value.len = (uint16_t)(end - h->value.off);
+            }
+            index_header(p, buf, h, req->num_headers);
+            req->num_headers++;
+
+            /* CRLF가 다 들어와 있으면 다음 줄로 바로 */
+            if (i + 1 < len && buf[i + 1] == '\n') {
+                i += 2;
+                state = kParseHeaderStart;
+                continue;
+            }
+            state = kParseLineLf;
+            break;
+
+        case kParseFinalLf:
+            if (c != '\n') {
+                return -1;
+            }
+
+            /* 완료: 명시한 Connection이 우선, 없으면 버전 기본값 */
+            req->complete = 1;
+            req->keep_alive = (p->flags & kFlagClose) ? 0
+                              : (p->flags & kFlagKeepAlive) ? 1
+                              : req->version.len == 8 && memcmp(buf + req->version.off, "HTTP/1.1", 8) == 0;
+
+            p->state = (unsigned char)state;
+            p->pos = i + 1;
+            return 1;
+        }
+        i++;
+    }
+
+    /* 64 KB에 헤더가 다 들어오지 않았다 */
+    if (i == UINT16_MAX) {
         return -1;
     }
-    
-    char *path_end = strchr(path_start, ' ');
-    if (!path_end || path_end > header_end) {
+
+    p->state = (unsigned char)state;
+    p->pos = i;
+    return 0;
+}
+
+static int execute_scalar(http_parser_t *p, const char *buf, size_t len)
+{
+    return parse_execute(p, buf, len, scan_scalar, mask_scalar);
+}
+
+#ifdef HTTP_SCAN_X86
+static int execute_sse2(http_parser_t *p, const char *buf, size_t len)
+{
+    return parse_execute(p, buf, len, scan_sse2, mask_sse2);
+}
+
+__attribute__((target("sse4.2")))
+static int execute_sse42(http_parser_t *p, const char *buf, size_t len)
+{
+    return parse_execute(p, buf, len, scan_sse42, mask_sse2);
+}
+
+__attribute__((target("avx2")))
+static int execute_avx2(http_parser_t *p, const char *buf, size_t len)
+{
+    return parse_execute(p, buf, len, scan_avx2, mask_avx2);
+}
+#endif
+
+static const struct {
+    const char *name;
+    int (*execute)(http_parser_t *p, const char *buf, size_t len);
+} kScanKernels[] = {
+#ifdef HTTP_SCAN_X86
+    {"avx2", execute_avx2},
+    {"sse4.2", execute_sse42},
+    {"sse2", execute_sse2},
+#endif
+    {"scalar", execute_scalar},
+};
+
+static int scan_kernel = (int)(sizeof(kScanKernels) / sizeof(kScanKernels[0])) - 1;
+
+static int scan_supported(const char *name)
+{
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(name, "sse4.2") == 0) {
+        return __builtin_cpu_supports("sse4.2");
+    }
+#endif
+    (void)name;
+    return 1;
+}
+
+#ifdef HTTP_SCAN_X86
+/*
+ * 실행 시 CPU에 맞춰 선택. SSE4.2 pcmpestri는 지연이 커서 구분자 세 개를
+ * 비교하는 SSE2보다 느리므로 자동 선택에서는 AVX2 다음이 SSE2다.
+ */
+__attribute__((constructor))
+static void scan_select(void)
+{
+    http_scan_use(scan_supported("avx2") ? "avx2" : "sse2");
+}
+#endif
+
+const char *http_scan_kernel(void)
+{
+    return kScanKernels[scan_kernel].name;
+}
+
+int http_scan_use(const char *name)
+{
+    for (size_t k = 0; k < sizeof(kScanKernels) / sizeof(kScanKernels[0]); k++) {
+        if (strcmp(kScanKernels[k].name, name) == 0 && scan_supported(name)) {
+            scan_kernel = (int)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int http_parser_execute(http_parser_t *p, const char *buf, size_t len)
+{
+    if (!p || !buf) {
         return -1;
     }
-    
-    size_t path_len = path_end - path_start;
-    if (path_len == 0 || path_len >= sizeof(out->path)) {
+    /* 슬라이스가 16비트 */
+    if (len > UINT16_MAX) {
+        len = UINT16_MAX;
+    }
+    return kScanKernels[scan_kernel].execute(p, buf, len);
+}
+
+int http_parse_request(const char *buf, size_t len, http_req_t *out)
+{
+    if (!buf || !out || len == 0) {
         return -1;
     }
-    
-    memcpy(out->path, path_start, path_len);
-    out->path[path_len] = '\0';
-    
-    if (strcmp(out->path, "/") == 0) {
-        strcpy(out->path, "/index.html");
+
+    http_parser_t parser;
+    http_parser_init(&parser);
+    int ret = http_parser_execute(&parser, buf, len);
+    *out = parser.req;
+    return ret;
+}
+
+const http_header_t *http_req_header(const http_req_t *req, int id)
+{
+    if (id < 0 || id >= kHttpKnownHeaders || req->known[id] < 0) {
+        return NULL;
     }
-    
-    return 1;
+    return &req->headers[req->known[id]];
+}
+
+const http_header_t *http_req_find(const http_req_t *req, const char *buf, const char *name)
+{
+    size_t len = strlen(name);
+
+    for (int k = 0; k < req->num_headers; k++) {
+        const http_header_t *h = &req->headers[k];
+        if (h->name.len == len && ascii_case_eq(buf + h->name.off, name, len)) {
+            return h;
+        }
+    }
+    return NULL;
 }
 
 const char *http_guess_type(const char *p)
@@ -76,7 +731,7 @@ const char *http_guess_type(const char *p)
     return "application/octet-stream";
 }
 
-int http_build_200(char *dst, size_t cap, long long content_len, const char *ctype)
+int http_build_200(char *dst, size_t cap, long long content_len, const char *ctype, int keep_alive)
 {
     if (!dst || !ctype || cap == 0) {
         return -1;
@@ -87,13 +742,13 @@ int http_build_200(char *dst, size_t cap, long long content_len, const char *cty
                      "Content-Length: %lld\r\n"
                      "Content-Type: %s\r\n"
                      "Cache-Control: no-cache\r\n"
-                     "Connection: close\r\n\r\n",
-                     content_len, ctype);
+                     "Connection: %s\r\n\r\n",
+                     content_len, ctype, keep_alive ? "keep-alive" : "close");
     
     return (n < 0 || (size_t)n >= cap) ? -1 : n;
 }
 
-int http_build_404(char *dst, size_t cap)
+int http_build_404(char *dst, size_t cap, int keep_alive)
 {
     if (!dst || cap == 0) {
         return -1;
@@ -104,13 +759,13 @@ int http_build_404(char *dst, size_t cap)
                      "HTTP/1.1 404 Not Found\r\n"
                      "Content-Length: %zu\r\n"
                      "Content-Type: text/plain\r\n"
-                     "Connection: close\r\n\r\n%s",
-                     strlen(body), body);
+                     "Connection: %s\r\n\r\n%s",
+                     strlen(body), keep_alive ? "keep-alive" : "close", body);
     
     return (n < 0 || (size_t)n >= cap) ? -1 : n;
 }
 
-int http_safe_join(char *out, size_t outsz, const char *root, const char *rel)
+int http_safe_join(char *out, size_t outsz, const char *root, const char *rel, size_t rel_len)
 {
     if (!out || !root || !rel || outsz == 0) {
         return -1;
@@ -119,16 +774,23 @@ int http_safe_join(char *out, size_t outsz, const char *root, const char *rel)
     char resolved[PATH_MAX];
     char temp_path[PATH_MAX];
     
+    /* rel은 요청 버퍼 안의 구간이라 NUL로 끝나지 않을 수 있다 */
     const char *clean_rel = rel;
-    if (clean_rel[0] == '/') {
+    size_t clean_len = rel_len;
+    if (clean_len > 0 && clean_rel[0] == '/') {
         clean_rel++;
+        clean_len--;
     }
     
-    if (strlen(clean_rel) == 0) {
+    if (clean_len == 0) {
         clean_rel = "index.html";
+        clean_len = strlen(clean_rel);
+    }
+    if (clean_len >= sizeof(temp_path)) {
+        return -1;
     }
     
-    int n = snprintf(temp_path, sizeof(temp_path), "%s/%s", root, clean_rel);
+    int n = snprintf(temp_path, sizeof(temp_path), "%s/%.*s", root, (int)clean_len, clean_rel);
     if (n < 0 || (size_t)n >= sizeof(temp_path)) {
         return -1;
     }
@@ -143,7 +805,7 @@ int http_safe_join(char *out, size_t outsz, const char *root, const char *rel)
             return -1;
         }
         
-        n = snprintf(out, outsz, "%s/%s", resolved, clean_rel);
+        n = snprintf(out, outsz, "%s/%.*s", resolved, (int)clean_len, clean_rel);
         if (n < 0 || (size_t)n >= outsz) {
             return -1;
         }
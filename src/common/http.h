@@ -1,17 +1,68 @@
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/types.h>
 
+enum
+{
+    kHttpMaxHeaders = 32, // 헤더 표 크기, 넘으면 에러
+};
+
+// 자주 보는 헤더: http_req_t.known 인덱스
+enum
+{
+    kHttpHost,
+    kHttpConnection,
+    kHttpIfNoneMatch,
+    kHttpRange,
+    kHttpAcceptEncoding,
+    kHttpKnownHeaders,
+};
+
+// 요청 버퍼 안의 구간, 복사하지 않는다 (요청 헤더는 64 KB 이하)
+typedef struct
+{
+    uint16_t off;
+    uint16_t len;
+} http_slice_t;
+
 typedef struct
 {
-    char method[8];
-    char path[1024];
-    int complete; // 헤더 파싱 완료 여부
+    http_slice_t name;
+    http_slice_t value; // 앞뒤 공백 제외
+} http_header_t;
+
+// 파싱한 요청: 모든 슬라이스는 파싱한 버퍼 기준, 버퍼가 움직이면 무효
+typedef struct
+{
+    http_slice_t method;
+    http_slice_t target; // 쿼리 포함 요청 경로
+    http_slice_t version;
+    http_header_t headers[kHttpMaxHeaders];
+    uint8_t num_headers;
+    int8_t known[kHttpKnownHeaders]; // headers 인덱스, 없으면 -1
+    uint8_t complete; // 헤더 파싱 완료 여부
+    uint8_t keep_alive; // HTTP/1.1이면 기본 1, Connection 헤더가 있으면 그 값
 } http_req_t;
 
-int http_parse_request(char *buf, size_t len, http_req_t *out); // 완료=1, 더필요=0, 에러<0
+// recv마다 이어서 파싱하는 상태. 버퍼 앞부분은 호출 사이에 그대로 유지되어야 한다.
+typedef struct
+{
+    size_t pos; // 다음에 볼 위치, 완료 시 빈 줄까지 포함한 요청 헤더 길이
+    unsigned char state;
+    unsigned char flags; // Connection 헤더 close/keep-alive
+    http_req_t req; // 완료되면 결과
+} http_parser_t;
+
+void http_parser_init(http_parser_t *p);
+int http_parser_execute(http_parser_t *p, const char *buf, size_t len); // 완료=1, 더필요=0, 에러<0
+int http_parse_request(const char *buf, size_t len, http_req_t *out); // 완료=1, 더필요=0, 에러<0
+const http_header_t *http_req_header(const http_req_t *req, int id); // 자주 보는 헤더, 없으면 NULL
+const http_header_t *http_req_find(const http_req_t *req, const char *buf, const char *name); // 대소문자 무시
+const char *http_scan_kernel(void); // 헤더 스캔 커널 이름 (avx2, sse4.2, sse2, scalar)
+int http_scan_use(const char *name); // 커널 강제 선택 (벤치마크용), 미지원=-1
 const char *http_guess_type(const char *path);
-int http_build_200(char *dst, size_t cap, long long content_len, const char *ctype);
-int http_build_404(char *dst, size_t cap);
+int http_build_200(char *dst, size_t cap, long long content_len, const char *ctype, int keep_alive);
+int http_build_404(char *dst, size_t cap, int keep_alive); // keep_alive=0 이면 Connection: close
 
-int http_safe_join(char *out, size_t outsz, const char *root, const char *rel);
\ No newline at end of file
+int http_safe_join(char *out, size_t outsz, const char *root, const char *rel, size_t rel_len);
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "timer_wheel.h"
+#include <time.h>
+
+static void list_insert(TimerNode *head, TimerNode *node)
+{
+    node->next = head->next;
+    node->prev = head;
+    head->next->prev = node;
+    head->next = node;
+}
+
+static void list_unlink(TimerNode *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+/* Place node in the slot for its expiry relative to the current tick */
+static void wheel_place(TimerWheel *tw, TimerNode *node)
+{
+    uint64_t delta = node->expires > tw->now_tick ? node->expires - tw->now_tick : 0;
+
+    if (delta < kTimerL0Slots) {
+        list_insert(&tw->level0[node->expires & (kTimerL0Slots - 1)], node);
+    } else {
+        list_insert(&tw->level1[(node->expires >> kTimerL0Bits) & (kTimerL1Slots - 1)], node);
+    }
+}
+
+uint64_t timer_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void timer_wheel_list_init(TimerNode *head)
+{
+    head->next = head;
+    head->prev = head;
+    head->expires = 0;
+}
+
+TimerNode *timer_wheel_list_pop(TimerNode *head)
+{
+    if (head->next == head) {
+        return NULL;
+    }
+
+    TimerNode *node = head->next;
+    list_unlink(node);
+    return node;
+}
+
+void timer_wheel_init(TimerWheel *tw, uint64_t now_ms)
+{
+    tw->now_tick = 0;
+    tw->start_ms = now_ms;
+    tw->count = 0;
+
+    for (int i = 0; i < kTimerL0Slots; i++) {
+        timer_wheel_list_init(&tw->level0[i]);
+    }
+    for (int i = 0; i < kTimerL1Slots; i++) {
+        timer_wheel_list_init(&tw->level1[i]);
+    }
+}
+
+void timer_node_init(TimerNode *node)
+{
+    node->next = NULL;
+    node->prev = NULL;
+    node->expires = 0;
+}
+
+void timer_wheel_schedule(TimerWheel *tw, TimerNode *node, uint64_t now_ms, uint64_t timeout_ms)
+{
+    uint64_t ticks = (timeout_ms + kTimerTickMs - 1) / kTimerTickMs;
+    uint64_t max_ticks = (uint64_t)kTimerL0Slots * kTimerL1Slots - 1;
+
+    if (node->next) {
+        list_unlink(node);
+        tw->count--;
+    }
+
+    /* Idle wheel fell behind the clock: nothing to fire, catch up */
+    uint64_t now_tick = now_ms > tw->start_ms ? (now_ms - tw->start_ms) / kTimerTickMs : 0;
+    if (tw->count == 0 && now_tick > tw->now_tick) {
+        tw->now_tick = now_tick;
+    }
+
+    /* Otherwise count the lag against the deadline, within wheel range */
+    uint64_t lag = now_tick > tw->now_tick ? now_tick - tw->now_tick : 0;
+    max_ticks = lag < max_ticks ? max_ticks - lag : 1;
+
+    if (ticks == 0) {
+        ticks = 1;
+    } else if (ticks > max_ticks) {
+        ticks = max_ticks;
+    }
+
+    tw->count++;
+    node->expires = tw->now_tick + lag + ticks;
+    wheel_place(tw, node);
+}
+
+void timer_wheel_cancel(TimerWheel *tw, TimerNode *node)
+{
+    if (!node->next) {
+        return;
+    }
+
+    list_unlink(node);
+    tw->count--;
+}
+
+size_t timer_wheel_advance(TimerWheel *tw, uint64_t now_ms, TimerNode *expired)
+{
+    uint64_t target = (now_ms - tw->start_ms) / kTimerTickMs;
+    size_t fired = 0;
+
+    while (tw->now_tick < target) {
+        tw->now_tick++;
+
+        if (tw->count == 0) {
+            /* Nothing scheduled: jump straight to the target tick */
+            tw->now_tick = target;
+            break;
+        }
+
+        size_t idx = tw->now_tick & (kTimerL0Slots - 1);
+
+        /* Level 0 wrapped: cascade the matching level 1 slot down */
+        if (idx == 0) {
+            TimerNode *slot = &tw->level1[(tw->now_tick >> kTimerL0Bits) & (kTimerL1Slots - 1)];
+            TimerNode *node;
+            TimerNode pending;
+
+            timer_wheel_list_init(&pending);
+            while ((node = timer_wheel_list_pop(slot)) != NULL) {
+                list_insert(&pending, node);
+            }
+            while ((node = timer_wheel_list_pop(&pending)) != NULL) {
+                wheel_place(tw, node);
+            }
+        }
+
+        /* Everything in this slot is due now */
+        TimerNode *node;
+        while ((node = timer_wheel_list_pop(&tw->level0[idx])) != NULL) {
+            list_insert(expired, node);
+            tw->count--;
+            fired++;
+        }
+    }
+
+    return fired;
+}
+
+int timer_wheel_timeout_ms(const TimerWheel *tw, uint64_t now_ms)
+{
+    if (tw->count == 0) {
+        return -1;
+    }
+
+    uint64_t next_tick_ms = tw->start_ms + (tw->now_tick + 1) * kTimerTickMs;
+    return next_tick_ms > now_ms ? (int)(next_tick_ms - now_ms) : 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timing wheel for connection timeouts.
+ *
+ * Two levels: 256 one-tick slots, then 64 slots of 256 ticks each. With
+ * the default 100 ms tick that covers ~27 minutes; longer timeouts are
+ * clamped. Schedule, re-arm and cancel are O(1) on an intrusive node
+ * embedded in the connection, so no per-connection timer or scan.
+ */
+
+enum
+{
+    kTimerTickMs = 100,
+    kTimerL0Bits = 8,
+    kTimerL1Bits = 6,
+    kTimerL0Slots = 1 << kTimerL0Bits,
+    kTimerL1Slots = 1 << kTimerL1Bits,
+};
+
+typedef struct TimerNode
+{
+    struct TimerNode *prev;
+    struct TimerNode *next; /* NULL while not scheduled */
+    uint64_t expires;       /* Absolute tick */
+} TimerNode;
+
+typedef struct
+{
+    uint64_t now_tick;
+    uint64_t start_ms;
+    size_t count;
+    TimerNode level0[kTimerL0Slots]; /* List heads */
+    TimerNode level1[kTimerL1Slots];
+} TimerWheel;
+
+/* Recover the structure embedding a TimerNode */
+#define timer_entry(node, type, member) \
+    ((type *)((char *)(node) - offsetof(type, member)))
+
+/**
+ * @brief Monotonic clock in milliseconds
+ */
+uint64_t timer_now_ms(void);
+
+/**
+ * @brief Initialize an empty wheel whose tick 0 starts at now_ms
+ */
+void timer_wheel_init(TimerWheel *tw, uint64_t now_ms);
+
+/**
+ * @brief Initialize a node as not scheduled
+ */
+void timer_node_init(TimerNode *node);
+
+/**
+ * @brief (Re)arm node to fire timeout_ms after now_ms
+ *
+ * The wheel only advances in timer_wheel_advance, so its tick may trail
+ * the clock (e.g. after blocking with nothing armed); the deadline is
+ * measured from now_ms regardless.
+ */
+void timer_wheel_schedule(TimerWheel *tw, TimerNode *node, uint64_t now_ms, uint64_t timeout_ms);
+
+/**
+ * @brief Disarm node; no-op if it is not scheduled
+ */
+void timer_wheel_cancel(TimerWheel *tw, TimerNode *node);
+
+/**
+ * @brief Advance the wheel to now_ms and move every due node onto expired
+ * @param expired List head initialized with timer_wheel_list_init
+ * @return Number of expired nodes
+ */
+size_t timer_wheel_advance(TimerWheel *tw, uint64_t now_ms, TimerNode *expired);
+
+/**
+ * @brief Milliseconds until the next tick, or -1 if nothing is scheduled
+ *
+ * Suitable as the timeout argument of poll/epoll_wait.
+ */
+int timer_wheel_timeout_ms(const TimerWheel *tw, uint64_t now_ms);
+
+/**
+ * @brief Initialize an empty list head (e.g. for timer_wheel_advance)
+ */
+void timer_wheel_list_init(TimerNode *head);
+
+/**
+ * @brief Unlink and return the first node of a list, or NULL if empty
+ */
+TimerNode *timer_wheel_list_pop(TimerNode *head);
@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/*
+ * Minimal io_uring ring (Linux only).
+ *
+ * Driven through the raw io_uring_setup/io_uring_enter syscalls so the
+ * servers have no dependency beyond kernel headers. SQEs are queued with
+ * ring_get_sqe() and published by the next ring_enter().
+ */
+
+typedef struct
+{
+    int fd;
+
+    /* Submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sq_pending_tail; /* Tail including not-yet-published SQEs */
+    unsigned to_submit;       /* SQEs queued since the last enter */
+    struct io_uring_sqe *sqes;
+
+    /* Completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* Mappings for teardown */
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+} Ring;
+
+/**
+ * @brief Set up the ring and map its queues
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int ring_init(Ring *ring, unsigned entries);
+
+/**
+ * @brief Unmap the queues and close the ring
+ */
+void ring_destroy(Ring *ring);
+
+/**
+ * @brief Get a zeroed SQE, flushing the queue to the kernel if it is full
+ * @return SQE, or NULL if the ring stays full
+ */
+struct io_uring_sqe *ring_get_sqe(Ring *ring);
+
+/**
+ * @brief Publish queued SQEs and optionally wait for completions
+ *
+ * Does not block if completions are already waiting to be reaped.
+ */
+int ring_enter(Ring *ring, unsigned wait_nr);
+
+/**
+ * @brief Like ring_enter(), but give up waiting after timeout_ms
+ *
+ * A negative timeout waits indefinitely. Returns 0 on timeout.
+ */
+int ring_enter_timeout(Ring *ring, unsigned wait_nr, int timeout_ms);
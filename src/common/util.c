@@ -1,6 +1,17 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* accept4, sched_setaffinity */
+#endif
+
 #include "util.h"
 #include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sched.h>
+#include <linux/filter.h>
+#endif
 
 int set_nonblock(int fd)
 {
@@ -15,4 +26,153 @@ int set_nonblock(int fd)
     }
     
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-}
\ No newline at end of file
+}
+
+int accept_nonblock(int listen_fd)
+{
+#ifdef SOCK_NONBLOCK
+    return accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    /* BSD/macOS: accepted sockets inherit O_NONBLOCK from the listener */
+    return accept(listen_fd, NULL, NULL);
+#endif
+}
+
+int accept_cloexec(int listen_fd)
+{
+#ifdef SOCK_CLOEXEC
+    return accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+#else
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd >= 0) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+#endif
+}
+
+int set_busy_poll(int fd, int usec)
+{
+    int ret = -1;
+
+#ifdef SO_BUSY_POLL
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0) {
+        ret = 0;
+    }
+#endif
+#ifdef SO_PREFER_BUSY_POLL
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on)) == 0) {
+        ret = 0;
+    }
+#endif
+
+    (void)fd;
+    (void)usec;
+    return ret;
+}
+
+int parse_cpu_list(const char *spec, int *cpus, int max_cpus)
+{
+    int count = 0;
+    const char *p = spec;
+
+    if (!spec || !*spec) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first > kMaxCpuId) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last > kMaxCpuId) {
+                errno = EINVAL;
+                return -1;
+            }
+            p = end;
+        }
+
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (count == max_cpus) {
+                errno = E2BIG;
+                return -1;
+            }
+            cpus[count++] = (int)cpu;
+        }
+
+        if (*p == ',') {
+            p++;
+            if (!*p) {
+                errno = EINVAL;
+                return -1;
+            }
+        } else if (*p) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    return count;
+}
+
+int pin_current_thread(int cpu)
+{
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    /* macOS only has affinity hints; the BSDs differ per system */
+    (void)cpu;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int attach_reuseport_cpu_steering(int fd, const int *socket_cpus, int num_sockets)
+{
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    /* ld cpu; one compare/return pair per socket; fallback cpu % n */
+    int len = 2 * num_sockets + 3;
+    struct sock_filter *code = calloc((size_t)len, sizeof(*code));
+    if (!code) {
+        return -1;
+    }
+
+    int n = 0;
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU);
+    for (int i = 0; i < num_sockets; i++) {
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                                 (unsigned)socket_cpus[i], 0, 1);
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, (unsigned)i);
+    }
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (unsigned)num_sockets);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_A, 0);
+
+    struct sock_fprog prog = {.len = (unsigned short)n, .filter = code};
+    int ret = setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+    free(code);
+    return ret;
+#else
+    (void)fd;
+    (void)socket_cpus;
+    (void)num_sockets;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
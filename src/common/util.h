@@ -1,8 +1,79 @@
 #pragma once
 
+enum
+{
+    kMaxCpuId = 1023, /* parse_cpu_list()가 받는 가장 큰 CPU 번호 */
+};
+
 /**
  * @brief 파일 디스크립터를 논블로킹 모드로 설정
  * @param fd 파일 디스크립터
  * @return 성공 시 0, 실패 시 -1 반환
  */
-int set_nonblock(int fd);
\ No newline at end of file
+int set_nonblock(int fd);
+
+/**
+ * @brief 논블로킹 리스닝 소켓에서 논블로킹 클라이언트 소켓을 accept
+ *
+ * 가능하면 accept4(SOCK_NONBLOCK | SOCK_CLOEXEC) 한 번으로 처리하고,
+ * accept4가 없는 BSD/macOS에서는 리스닝 소켓의 O_NONBLOCK이 상속된다.
+ * TCP_NODELAY 등 소켓 옵션은 리스닝 소켓에 설정해 상속받는다.
+ * @param listen_fd 리스닝 소켓 (논블로킹)
+ * @return 성공 시 클라이언트 fd, 실패 시 -1 (errno 설정)
+ */
+int accept_nonblock(int listen_fd);
+
+/**
+ * @brief 블로킹 클라이언트 소켓을 close-on-exec로 accept
+ * @param listen_fd 리스닝 소켓
+ * @return 성공 시 클라이언트 fd, 실패 시 -1 (errno 설정)
+ */
+int accept_cloexec(int listen_fd);
+
+/**
+ * @brief 소켓에 busy polling 옵션 설정 (Linux 전용, 실패는 무시)
+ *
+ * SO_BUSY_POLL로 수신 시 지정 시간만큼 NIC 큐를 직접 폴링하고,
+ * 지원되면 SO_PREFER_BUSY_POLL로 인터럽트보다 busy polling을 우선한다.
+ * sysctl net.core.busy_read보다 큰 값은 CAP_NET_ADMIN이 필요하다.
+ * @param fd 소켓
+ * @param usec 폴링 시간 (마이크로초)
+ * @return 하나라도 설정되면 0, 아니면 -1
+ */
+int set_busy_poll(int fd, int usec);
+
+
+/**
+ * @brief "0-3,8,10-11" 형식의 CPU 목록을 파싱
+ *
+ * 나열된 순서 그대로 저장하며 중복은 걸러내지 않는다.
+ * @param spec CPU 목록 문자열
+ * @param cpus 결과를 저장할 배열
+ * @param max_cpus cpus 배열 크기
+ * @return 성공 시 CPU 개수, 형식 오류나 배열 초과 시 -1 (errno 설정)
+ */
+int parse_cpu_list(const char *spec, int *cpus, int max_cpus);
+
+/**
+ * @brief 호출한 스레드를 지정한 CPU 하나에 고정 (Linux 전용)
+ *
+ * 고정된 뒤 스레드가 처음 쓰는 메모리는 first-touch 정책에 따라
+ * 해당 CPU의 NUMA 노드에 할당된다.
+ * @param cpu CPU 번호
+ * @return 성공 시 0, 실패 시 -1 (지원하지 않는 OS에서는 ENOSYS)
+ */
+int pin_current_thread(int cpu);
+
+/**
+ * @brief SO_REUSEPORT 그룹에 CPU 기반 분배 프로그램(classic BPF)을 붙임
+ *
+ * 패킷을 받은 CPU가 socket_cpus[i]와 같으면 그룹의 i번째 소켓으로
+ * 보내고, 목록에 없는 CPU는 cpu % num_sockets번째 소켓으로 보낸다.
+ * 그룹 인덱스는 listen() 순서이므로 소켓은 socket_cpus 순서대로
+ * 만들어야 한다. 그룹의 아무 소켓에나 한 번 붙이면 된다.
+ * @param fd SO_REUSEPORT 리스닝 소켓
+ * @param socket_cpus 각 소켓을 처리하는 스레드의 CPU
+ * @param num_sockets 그룹의 소켓 개수
+ * @return 성공 시 0, 실패 시 -1 (지원하지 않는 OS에서는 ENOSYS)
+ */
+int attach_reuseport_cpu_steering(int fd, const int *socket_cpus, int num_sockets);
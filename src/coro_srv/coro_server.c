@@ -0,0 +1,981 @@
+/**
+ * Coroutine-based HTTP Server Implementation
+ *
+ * Request handling reads like the thread server's: recv, parse, stat,
+ * send the file, loop for keep-alive. The difference is underneath:
+ * sockets are non-blocking, and co_recv()/co_send_all() yield to the
+ * scheduler on EAGAIN instead of parking a kernel thread. An idle
+ * connection costs its Conn (request buffer included) and the touched
+ * pages of its stack; the response buffer is only borrowed while a
+ * response is being written.
+ */
+
+#include "coro_server.h"
+#include "../common/coro.h"
+#include "../common/http.h"
+#include "../common/util.h"
+#include "../common/timer_wheel.h"
+#include "../event/event_backend.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Configuration */
+enum
+{
+    kMaxEvents = 1024,           /* Events per scheduler wait */
+    kMaxThreads = 256,           /* Upper bound for --threads */
+    kStackSize = 64 * 1024,      /* Coroutine stack, pooled; realpath() in
+                                    http_safe_join() alone takes ~16 KB */
+    kMaxRequestSize = 4096,      /* Per-connection read buffer */
+    kMaxPathSize = 1024,         /* Path buffer */
+    kMaxHeaderSize = 512,        /* Response header buffer */
+    kResponseBufferSize = 32768, /* Borrowed while writing a response */
+    kListenBacklog = 10000,      /* Match system somaxconn */
+    kKeepAliveMax = 100,         /* Max requests per connection */
+    kIdleTimeoutMs = 5000,       /* Waiting for the next request */
+    kIoTimeoutMs = 10000,        /* Rest of a request, or send progress */
+    kLingerTimeoutMs = 2000,     /* Discarding input after the last response */
+    kStatsIntervalSec = 10,      /* Aggregated stats print interval */
+};
+
+/*
+ * Stats are written only by the owning scheduler and read by the stats
+ * printer on scheduler 0; relaxed atomics keep those reads tear-free.
+ */
+#define STAT_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+#define STAT_READ(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+struct Scheduler;
+
+/* One connection and the coroutine serving it */
+typedef struct Conn
+{
+    CoroContext ctx;
+    void *stack;
+    struct Scheduler *sched;
+    int fd;
+    unsigned interest; /* Registered with the backend, 0 = not yet */
+    bool waiting;      /* Blocked in co_wait() */
+    bool timed_out;    /* Woken by its timer rather than the fd */
+    bool done;         /* Handler finished, reclaimed after the switch */
+    TimerNode timer;   /* Deadline of the current wait */
+    struct Conn *next; /* Free list */
+
+    /* Response under construction, flushed before every read */
+    char *out;
+    size_t out_len;
+
+    /* Request bytes, pipelined ones carried to the next request */
+    size_t in_len;
+    char in[kMaxRequestSize];
+} Conn;
+
+/*
+ * Scheduler context
+ *
+ * One per thread, sharing nothing with the others: its own listener,
+ * event backend, stack pool and free lists.
+ */
+typedef struct Scheduler
+{
+    int id;
+    EventBackend *eb;     /* Readiness backend, also owns the timers */
+    int listen_fd;        /* SO_REUSEPORT listener */
+    const char *doc_root; /* Document root */
+    pthread_t thread;     /* Scheduler 0 runs on the caller */
+    int cpu;              /* CPU the thread is pinned to, -1 = none */
+    CoroContext loop;     /* Where coroutines yield to */
+
+    CoroStackPool stacks;
+    Conn *free_conns;
+    void *free_buffers; /* Idle response buffers, linked through their first word */
+
+    /* Statistics */
+    int num_active;
+    uint64_t total_connections;
+    uint64_t total_requests;
+    uint64_t total_timeouts;
+
+    /* Scheduler group, for stats aggregation on scheduler 0 */
+    struct Scheduler *group;
+    int group_size;
+} Scheduler;
+
+/* Function prototypes */
+static int scheduler_init(Scheduler *s, const char *bind_addr, int port);
+static void scheduler_cleanup(Scheduler *s);
+static void *scheduler_thread(void *arg);
+static int scheduler_run(Scheduler *s);
+static void accept_connections(Scheduler *s);
+static Conn *conn_alloc(Scheduler *s, int fd);
+static void conn_free(Scheduler *s, Conn *c);
+static void conn_resume(Scheduler *s, Conn *c);
+static void conn_main(void *arg);
+static int co_wait(Conn *c, unsigned events, int timeout_ms);
+static ssize_t co_recv(Conn *c, void *buf, size_t len, int timeout_ms);
+static int co_send_all(Conn *c, const char *buf, size_t len);
+static void co_linger(Conn *c);
+static void handle_connection(Conn *c);
+static int process_request(Conn *c, const http_req_t *request, bool keep_alive);
+static int send_file_response(Conn *c, const char *file_path, bool keep_alive);
+static int send_error_response(Conn *c, int status_code, bool keep_alive);
+static int response_reserve(Conn *c, size_t len);
+static int response_flush(Conn *c);
+static void print_stats(Scheduler *s);
+static int increase_fd_limit(void);
+static int create_listen_socket(const char *bind_addr, int port);
+
+/**
+ * Start the schedulers: 1..N-1 on their own threads, 0 on the caller
+ */
+int run_coro_server_opts(const char *bind_addr, int port, const char *doc_root,
+                         const CoroServerOptions *opts)
+{
+    int num_threads = opts->num_threads;
+
+    if (!doc_root)
+    {
+        fprintf(stderr, "Error: document root required\n");
+        return -1;
+    }
+
+    if (num_threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (online < kMaxThreads ? (int)online : kMaxThreads) : 1;
+    }
+
+    if (num_threads < 1 || num_threads > kMaxThreads)
+    {
+        fprintf(stderr, "Error: threads must be between 1 and %d\n", kMaxThreads);
+        return -1;
+    }
+
+    /* Increase file descriptor limit for C10K+ */
+    if (increase_fd_limit() < 0)
+    {
+        fprintf(stderr, "Warning: Could not increase fd limit\n");
+    }
+
+    /* Ignore SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+
+    Scheduler *scheds = calloc(num_threads, sizeof(Scheduler));
+    if (!scheds)
+    {
+        perror("calloc");
+        return -1;
+    }
+
+    for (int i = 0; i < num_threads; i++)
+    {
+        scheds[i].id = i;
+        scheds[i].doc_root = doc_root;
+        scheds[i].cpu = opts->num_cpus > 0 ? opts->cpus[i % opts->num_cpus] : -1;
+        scheds[i].group = scheds;
+        scheds[i].group_size = num_threads;
+
+        if (scheduler_init(&scheds[i], bind_addr, port) < 0)
+        {
+            while (--i >= 0)
+                scheduler_cleanup(&scheds[i]);
+            free(scheds);
+            return -1;
+        }
+    }
+
+    /* Steer each connection to the scheduler pinned to its CPU */
+    if (opts->num_cpus > 0 && num_threads > 1)
+    {
+        int socket_cpus[kMaxThreads];
+        for (int i = 0; i < num_threads; i++)
+            socket_cpus[i] = scheds[i].cpu;
+
+        if (attach_reuseport_cpu_steering(scheds[0].listen_fd, socket_cpus, num_threads) < 0)
+        {
+            perror("Warning: SO_ATTACH_REUSEPORT_CBPF");
+        }
+    }
+
+    fprintf(stderr, "Coroutine server (%s) listening on %s:%d (doc_root: %s)\n",
+            eb_name(), bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
+    fprintf(stderr, "Schedulers: %d, coroutine stacks: %d KB\n",
+            num_threads, kStackSize / 1024);
+    if (opts->num_cpus > 0)
+    {
+        fprintf(stderr, "Pinning: %d schedulers over %d CPUs\n", num_threads, opts->num_cpus);
+    }
+
+    int started = 1;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&scheds[started].thread, NULL, scheduler_thread, &scheds[started]) != 0)
+        {
+            fprintf(stderr, "Failed to create scheduler thread %d\n", started);
+            break;
+        }
+    }
+
+    int ret = scheduler_run(&scheds[0]);
+
+    /* Cleanup */
+    for (int i = 1; i < started; i++)
+    {
+        pthread_join(scheds[i].thread, NULL);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        scheduler_cleanup(&scheds[i]);
+    }
+    free(scheds);
+
+    return ret;
+}
+
+/**
+ * Create a scheduler's event backend and listener
+ */
+static int scheduler_init(Scheduler *s, const char *bind_addr, int port)
+{
+    s->eb = eb_create(1024);
+    if (!s->eb)
+    {
+        perror("eb_create");
+        return -1;
+    }
+
+    /* SO_REUSEPORT lets every scheduler bind */
+    s->listen_fd = create_listen_socket(bind_addr, port);
+    if (s->listen_fd < 0)
+    {
+        eb_destroy(s->eb);
+        return -1;
+    }
+
+    /* NULL udata marks the listener */
+    if (eb_register(s->eb, s->listen_fd, kEbRead, NULL) < 0)
+    {
+        perror("eb_register");
+        close(s->listen_fd);
+        eb_destroy(s->eb);
+        return -1;
+    }
+
+    coro_stack_pool_init(&s->stacks, kStackSize);
+    return 0;
+}
+
+/**
+ * Release a scheduler's pools, listener and event backend
+ *
+ * Only reached once the loop has failed, so coroutines still suspended
+ * are abandoned along with their stacks.
+ */
+static void scheduler_cleanup(Scheduler *s)
+{
+    while (s->free_conns)
+    {
+        Conn *c = s->free_conns;
+        s->free_conns = c->next;
+        free(c);
+    }
+    while (s->free_buffers)
+    {
+        void *buf = s->free_buffers;
+        s->free_buffers = *(void **)buf;
+        free(buf);
+    }
+    coro_stack_pool_destroy(&s->stacks);
+    close(s->listen_fd);
+    eb_destroy(s->eb);
+}
+
+static void *scheduler_thread(void *arg)
+{
+    scheduler_run((Scheduler *)arg);
+    return NULL;
+}
+
+/**
+ * Pin the calling thread and run the scheduler loop
+ *
+ * Resumes a coroutine for every readiness event on its fd and for
+ * every expired deadline; the listener's events start new ones.
+ */
+static int scheduler_run(Scheduler *s)
+{
+    EbEvent events[kMaxEvents];
+
+    if (s->cpu >= 0 && pin_current_thread(s->cpu) < 0)
+    {
+        fprintf(stderr, "Warning: scheduler %d not pinned to CPU %d: %s\n",
+                s->id, s->cpu, strerror(errno));
+    }
+
+    while (1)
+    {
+        int nev = eb_wait(s->eb, events, kMaxEvents, -1);
+        if (nev < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("eb_wait");
+            return -1;
+        }
+
+        for (int i = 0; i < nev; i++)
+        {
+            Conn *c = (Conn *)events[i].udata;
+
+            if (!c)
+            {
+                accept_connections(s);
+                continue;
+            }
+
+            /*
+             * Errors and hangups are left for the coroutine's next
+             * recv/send to report. Not waiting: it finished (or its
+             * Conn was reused) earlier in this batch.
+             */
+            if (c->waiting)
+                conn_resume(s, c);
+        }
+
+        /* Deadlines: the coroutine sees ETIMEDOUT from its wait */
+        TimerNode expired;
+        timer_wheel_list_init(&expired);
+        eb_expire(s->eb, &expired);
+
+        TimerNode *node;
+        while ((node = timer_wheel_list_pop(&expired)) != NULL)
+        {
+            Conn *c = timer_entry(node, Conn, timer);
+            c->timed_out = true;
+            conn_resume(s, c);
+        }
+
+        /* Scheduler 0 prints aggregated stats periodically */
+        if (s->id == 0)
+        {
+            print_stats(s);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Accept new connections, running each until its first blocking read
+ */
+static void accept_connections(Scheduler *s)
+{
+    while (1)
+    {
+        /* Non-blocking and TCP_NODELAY come with the socket */
+        int fd = accept_nonblock(s->listen_fd);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            break;
+        }
+
+        Conn *c = conn_alloc(s, fd);
+        if (!c)
+        {
+            close(fd);
+            continue;
+        }
+
+        STAT_ADD(s->total_connections, 1);
+        conn_resume(s, c);
+    }
+}
+
+/**
+ * Take a Conn and a stack from the scheduler's pools and prepare the
+ * coroutine for fd
+ */
+static Conn *conn_alloc(Scheduler *s, int fd)
+{
+    Conn *c = s->free_conns;
+    if (c)
+    {
+        s->free_conns = c->next;
+    }
+    else if (!(c = malloc(sizeof(Conn))))
+    {
+        return NULL;
+    }
+
+    c->stack = coro_stack_alloc(&s->stacks);
+    if (!c->stack)
+    {
+        c->next = s->free_conns;
+        s->free_conns = c;
+        return NULL;
+    }
+
+    c->sched = s;
+    c->fd = fd;
+    c->interest = 0;
+    c->waiting = false;
+    c->timed_out = false;
+    c->done = false;
+    c->out = NULL;
+    c->out_len = 0;
+    timer_node_init(&c->timer);
+    coro_make(&c->ctx, c->stack, kStackSize, conn_main, c);
+
+    STAT_ADD(s->num_active, 1);
+    return c;
+}
+
+/**
+ * Close a finished connection and return its Conn and stack
+ *
+ * Runs on the scheduler stack: a coroutine cannot free its own.
+ */
+static void conn_free(Scheduler *s, Conn *c)
+{
+    eb_timer_cancel(s->eb, &c->timer);
+    if (c->interest)
+        eb_close(s->eb, c->fd);
+    else
+        close(c->fd);
+
+    if (c->out)
+    {
+        *(void **)c->out = s->free_buffers;
+        s->free_buffers = c->out;
+    }
+
+    coro_stack_free(&s->stacks, c->stack);
+    c->next = s->free_conns;
+    s->free_conns = c;
+    STAT_ADD(s->num_active, -1);
+}
+
+/**
+ * Run a coroutine until it yields or finishes
+ */
+static void conn_resume(Scheduler *s, Conn *c)
+{
+    coro_switch(&s->loop, &c->ctx);
+
+    if (c->done)
+        conn_free(s, c);
+}
+
+/**
+ * Coroutine entry: serve the connection, then hand back for good
+ */
+static void conn_main(void *arg)
+{
+    Conn *c = (Conn *)arg;
+
+    handle_connection(c);
+
+    c->done = true;
+    coro_switch(&c->ctx, &c->sched->loop);
+}
+
+/**
+ * Block this coroutine until fd is ready for events or timeout_ms passes
+ *
+ * The fd stays registered between waits; only a change of direction
+ * costs a modify.
+ *
+ * @return 0 when ready, -1 on timeout (errno ETIMEDOUT) or failure
+ */
+static int co_wait(Conn *c, unsigned events, int timeout_ms)
+{
+    Scheduler *s = c->sched;
+
+    if (c->interest != events)
+    {
+        int ret = c->interest ? eb_modify(s->eb, c->fd, events, c)
+                              : eb_register(s->eb, c->fd, events, c);
+        if (ret < 0)
+        {
+            return -1;
+        }
+        c->interest = events;
+    }
+
+    eb_timer_schedule(s->eb, &c->timer, timeout_ms);
+    c->timed_out = false;
+    c->waiting = true;
+
+    coro_switch(&c->ctx, &s->loop);
+
+    c->waiting = false;
+    eb_timer_cancel(s->eb, &c->timer);
+
+    if (c->timed_out)
+    {
+        STAT_ADD(s->total_timeouts, 1);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * recv() that yields instead of blocking
+ */
+static ssize_t co_recv(Conn *c, void *buf, size_t len, int timeout_ms)
+{
+    while (1)
+    {
+        ssize_t n = recv(c->fd, buf, len, 0);
+        if (n >= 0)
+            return n;
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+        if (co_wait(c, kEbRead, timeout_ms) < 0)
+            return -1;
+    }
+}
+
+/**
+ * Send all of buf, yielding whenever the socket buffer is full
+ */
+static int co_send_all(Conn *c, const char *buf, size_t len)
+{
+    size_t sent = 0;
+
+    while (sent < len)
+    {
+        ssize_t n = send(c->fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            sent += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            return -1;
+        if (co_wait(c, kEbWrite, kIoTimeoutMs) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Shut down output and discard input until EOF or kLingerTimeoutMs passes,
+ * so the responses already sent reach the client before the close
+ */
+static void co_linger(Conn *c)
+{
+    if (shutdown(c->fd, SHUT_WR) < 0)
+        return;
+
+    uint64_t deadline = timer_now_ms() + kLingerTimeoutMs;
+    while (1)
+    {
+        uint64_t now = timer_now_ms();
+        if (now >= deadline)
+            return;
+        if (co_recv(c, c->in, sizeof(c->in), (int)(deadline - now)) <= 0)
+            return;
+    }
+}
+
+/**
+ * Handle connection with keep-alive and pipelining support
+ */
+static void handle_connection(Conn *c)
+{
+    Scheduler *s = c->sched;
+    bool keep_alive = true;
+    int requests = 0;
+
+    http_parser_t parser; /* Scan position survives partial reads */
+
+    c->in_len = 0;
+    http_parser_init(&parser);
+
+    while (1)
+    {
+        /* Serve every complete request already buffered */
+        int parsed = http_parser_execute(&parser, c->in, c->in_len);
+        if (parsed < 0)
+        {
+            send_error_response(c, 400, false);
+            break;
+        }
+        if (parsed > 0)
+        {
+            size_t request_len = parser.pos;
+
+            /* The last request allowed on this connection says so */
+            keep_alive = parser.req.keep_alive && requests + 1 < kKeepAliveMax;
+            requests++;
+            if (process_request(c, &parser.req, keep_alive) < 0)
+            {
+                return;
+            }
+
+            STAT_ADD(s->total_requests, 1);
+
+            c->in_len -= request_len;
+            memmove(c->in, c->in + request_len, c->in_len);
+            http_parser_init(&parser);
+
+            if (!keep_alive)
+                break;
+            continue;
+        }
+
+        if (c->in_len == sizeof(c->in))
+        {
+            /* Headers do not fit */
+            send_error_response(c, 400, false);
+            break;
+        }
+
+        /* Out of complete requests: one write for all their responses */
+        if (response_flush(c) < 0)
+        {
+            return;
+        }
+
+        /* Between requests the client may idle; mid-request it may not */
+        ssize_t n = co_recv(c, c->in + c->in_len, sizeof(c->in) - c->in_len,
+                            c->in_len ? kIoTimeoutMs : kIdleTimeoutMs);
+        if (n <= 0)
+        {
+            return; /* EOF, error or timeout */
+        }
+        c->in_len += (size_t)n;
+    }
+
+    /* Every break above ends the connection early: unread or pipelined
+       input would turn a plain close into a RST */
+    if (response_flush(c) == 0)
+        co_linger(c);
+}
+
+/**
+ * Process a single parsed HTTP request, appending the response to the buffer
+ *
+ * @return 0 on success, -1 if the connection failed
+ */
+static int process_request(Conn *c, const http_req_t *request, bool keep_alive)
+{
+    char file_path[kMaxPathSize];
+
+    /* Build file path */
+    if (http_safe_join(file_path, sizeof(file_path), c->sched->doc_root,
+                       c->in + request->target.off, request->target.len) < 0)
+    {
+        return send_error_response(c, 404, keep_alive);
+    }
+
+    /* Check file */
+    struct stat file_stat;
+    if (stat(file_path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        return send_error_response(c, 404, keep_alive);
+    }
+
+    /* Send response */
+    return send_file_response(c, file_path, keep_alive);
+}
+
+/**
+ * Send file response with keep-alive support
+ */
+static int send_file_response(Conn *c, const char *file_path, bool keep_alive)
+{
+    int file_fd = open(file_path, O_RDONLY);
+    if (file_fd < 0)
+    {
+        return send_error_response(c, 500, keep_alive);
+    }
+
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) != 0)
+    {
+        close(file_fd);
+        return send_error_response(c, 500, keep_alive);
+    }
+
+    /* Build header with keep-alive */
+    if (response_reserve(c, kMaxHeaderSize) < 0)
+    {
+        close(file_fd);
+        return -1;
+    }
+    c->out_len += (size_t)snprintf(c->out + c->out_len, kMaxHeaderSize,
+                                   "HTTP/1.1 200 OK\r\n"
+                                   "Content-Length: %lld\r\n"
+                                   "Content-Type: %s\r\n"
+                                   "Connection: %s\r\n"
+                                   "\r\n",
+                                   (long long)file_stat.st_size,
+                                   http_guess_type(file_path),
+                                   keep_alive ? "keep-alive" : "close");
+
+    /* Body straight into the response buffer, flushing when it fills */
+    while (1)
+    {
+        if (response_reserve(c, 1) < 0)
+        {
+            close(file_fd);
+            return -1;
+        }
+
+        ssize_t bytes_read = read(file_fd, c->out + c->out_len, kResponseBufferSize - c->out_len);
+        if (bytes_read < 0)
+        {
+            close(file_fd);
+            return -1; /* Header already out: only closing is honest */
+        }
+        if (bytes_read == 0)
+            break;
+        c->out_len += (size_t)bytes_read;
+    }
+
+    close(file_fd);
+    return 0;
+}
+
+/**
+ * Send error response with keep-alive support
+ */
+static int send_error_response(Conn *c, int status_code, bool keep_alive)
+{
+    const char *status_text;
+    const char *body;
+
+    switch (status_code)
+    {
+    case 400:
+        status_text = "400 Bad Request";
+        body = "Bad Request";
+        break;
+    case 404:
+        status_text = "404 Not Found";
+        body = "Not Found";
+        break;
+    case 500:
+        status_text = "500 Internal Server Error";
+        body = "Internal Server Error";
+        break;
+    default:
+        return -1;
+    }
+
+    if (response_reserve(c, kMaxHeaderSize) < 0)
+    {
+        return -1;
+    }
+    c->out_len += (size_t)snprintf(c->out + c->out_len, kMaxHeaderSize,
+                                   "HTTP/1.1 %s\r\n"
+                                   "Content-Length: %zu\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "Connection: %s\r\n"
+                                   "\r\n"
+                                   "%s",
+                                   status_text,
+                                   strlen(body),
+                                   keep_alive ? "keep-alive" : "close",
+                                   body);
+    return 0;
+}
+
+/**
+ * Make room for len bytes, borrowing a buffer from the scheduler or
+ * flushing the current one
+ */
+static int response_reserve(Conn *c, size_t len)
+{
+    if (c->out && c->out_len + len > kResponseBufferSize && response_flush(c) < 0)
+    {
+        return -1;
+    }
+
+    if (!c->out)
+    {
+        Scheduler *s = c->sched;
+        if (s->free_buffers)
+        {
+            c->out = s->free_buffers;
+            s->free_buffers = *(void **)c->out;
+        }
+        else if (!(c->out = malloc(kResponseBufferSize)))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Write out everything buffered and give the buffer back
+ */
+static int response_flush(Conn *c)
+{
+    if (!c->out)
+    {
+        return 0;
+    }
+
+    int ret = co_send_all(c, c->out, c->out_len);
+
+    Scheduler *s = c->sched;
+    *(void **)c->out = s->free_buffers;
+    s->free_buffers = c->out;
+    c->out = NULL;
+    c->out_len = 0;
+
+    return ret;
+}
+
+/**
+ * Print stats summed over all schedulers
+ */
+static void print_stats(Scheduler *s)
+{
+    static time_t last_stats = 0;
+    static int max_active = 0;
+    time_t now = time(NULL);
+
+    int active = 0;
+    uint64_t connections = 0, requests = 0, timeouts = 0;
+
+    for (int i = 0; i < s->group_size; i++)
+    {
+        Scheduler *r = &s->group[i];
+        active += STAT_READ(r->num_active);
+        connections += STAT_READ(r->total_connections);
+        requests += STAT_READ(r->total_requests);
+        timeouts += STAT_READ(r->total_timeouts);
+    }
+
+    if (active > max_active)
+        max_active = active;
+
+    if (now - last_stats >= kStatsIntervalSec)
+    {
+        fprintf(stderr, "Stats: schedulers=%d active=%d max=%d total=%llu requests=%llu timeouts=%llu\n",
+                s->group_size,
+                active,
+                max_active,
+                (unsigned long long)connections,
+                (unsigned long long)requests,
+                (unsigned long long)timeouts);
+        last_stats = now;
+    }
+}
+
+/**
+ * Increase file descriptor limit for C10K+
+ */
+static int increase_fd_limit(void)
+{
+    struct rlimit rlim;
+
+    if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        return -1;
+    }
+
+    /* Try to set to maximum, then a reasonable value */
+    rlim.rlim_cur = rlim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        rlim.rlim_cur = 65536;
+        rlim.rlim_max = 65536;
+        if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+        {
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "File descriptor limit: %llu\n",
+            (unsigned long long)rlim.rlim_cur);
+    return 0;
+}
+
+/**
+ * Create and configure a non-blocking SO_REUSEPORT listening socket
+ */
+static int create_listen_socket(const char *bind_addr, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    if (set_nonblock(fd) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("SO_REUSEADDR");
+        close(fd);
+        return -1;
+    }
+
+#ifdef SO_REUSEPORT
+    /* One listener per scheduler; the kernel spreads connections */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        /* Non-fatal */
+    }
+#endif
+
+    /* Accepted sockets inherit TCP_NODELAY from the listener */
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = bind_addr ? inet_addr(bind_addr) : INADDR_ANY};
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, kListenBacklog) < 0)
+    {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
@@ -0,0 +1,38 @@
+#ifndef CORO_SERVER_H
+#define CORO_SERVER_H
+
+/**
+ * Coroutine-based HTTP Server
+ *
+ * M:N model: every connection runs its handler in blocking style on a
+ * small pooled coroutine stack, and a handful of scheduler threads
+ * multiplex them over the event backend. A recv/send that would block
+ * registers interest and yields to the scheduler, which resumes the
+ * coroutine when the fd is ready or its timeout expires.
+ */
+
+/* Tuning knobs for run_coro_server_opts() */
+typedef struct
+{
+    int num_threads; /* Scheduler threads; 0 = one per online CPU */
+    const int *cpus; /* Scheduler i is pinned to cpus[i % num_cpus];
+                        NULL = unpinned */
+    int num_cpus;
+} CoroServerOptions;
+
+/**
+ * Starts the coroutine-based HTTP server
+ *
+ * Each scheduler owns an SO_REUSEPORT listener, an event backend and
+ * its coroutines; connections never migrate between schedulers.
+ *
+ * @param bind_addr IP address to bind (NULL for INADDR_ANY)
+ * @param port      Port number to listen on
+ * @param doc_root  Document root directory path
+ * @param opts      Scheduler threads and pinning
+ * @return          0 on success, -1 on failure
+ */
+int run_coro_server_opts(const char *bind_addr, int port, const char *doc_root,
+                         const CoroServerOptions *opts);
+
+#endif /* CORO_SERVER_H */
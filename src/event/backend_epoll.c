@@ -0,0 +1,273 @@
+/**
+ * Event Backend - epoll (Linux)
+ *
+ * Interest changes are coalesced per fd and applied right before
+ * epoll_wait(), so a connection that flips read -> write -> read within
+ * one iteration costs no epoll_ctl at all. close() drops the fd from the
+ * epoll set, so eb_close() needs no EPOLL_CTL_DEL.
+ */
+
+#include "backend_impl.h"
+
+#include <sys/epoll.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *const kBackendName = "epoll";
+
+typedef struct
+{
+    void *udata;
+    uint32_t wanted;  /* Interest requested by the caller */
+    uint32_t armed;   /* Interest registered with epoll, 0 = none */
+    int registered;   /* Known to this backend */
+    int pending;      /* Queued in BackendImpl.pending */
+} FdSlot;
+
+struct BackendImpl
+{
+    int epfd;
+    FdSlot *slots; /* Indexed by fd */
+    int nslots;
+
+    /* Fds whose interest changed since the last wait */
+    int *pending;
+    int npending;
+    int pending_capacity;
+
+    struct epoll_event *events;
+    int events_capacity;
+};
+
+static uint32_t to_epoll(unsigned events)
+{
+    uint32_t ev = 0;
+
+    if (events & kEbRead)
+        ev |= EPOLLIN;
+    if (events & kEbWrite)
+        ev |= EPOLLOUT;
+
+    return ev;
+}
+
+static int queue_change(BackendImpl *b, int fd)
+{
+    FdSlot *slot = &b->slots[fd];
+
+    if (slot->pending)
+    {
+        return 0;
+    }
+
+    if (b->npending == b->pending_capacity)
+    {
+        int capacity = b->pending_capacity ? b->pending_capacity * 2 : 256;
+        int *grown = realloc(b->pending, (size_t)capacity * sizeof(int));
+        if (!grown)
+        {
+            return -1;
+        }
+        b->pending = grown;
+        b->pending_capacity = capacity;
+    }
+
+    slot->pending = 1;
+    b->pending[b->npending++] = fd;
+    return 0;
+}
+
+/**
+ * Apply queued interest changes before waiting
+ *
+ * A failed epoll_ctl is reported to the caller as a kEbError event so
+ * it can drop the connection. Returns the number of such events.
+ */
+static int flush_changes(BackendImpl *b, EbEvent *events, int max_events)
+{
+    int nerr = 0;
+
+    for (int i = 0; i < b->npending; i++)
+    {
+        int fd = b->pending[i];
+        FdSlot *slot = &b->slots[fd];
+        slot->pending = 0;
+
+        /* Closed since queued, or back where it started */
+        if (!slot->registered || slot->wanted == slot->armed)
+            continue;
+
+        struct epoll_event ev = {.events = slot->wanted, .data.fd = fd};
+        int op = slot->armed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+        if (epoll_ctl(b->epfd, op, fd, &ev) < 0)
+        {
+            perror("epoll_ctl");
+            if (nerr < max_events)
+            {
+                events[nerr].udata = slot->udata;
+                events[nerr].events = kEbError;
+                nerr++;
+            }
+            continue;
+        }
+        slot->armed = slot->wanted;
+    }
+
+    b->npending = 0;
+    return nerr;
+}
+
+BackendImpl *backend_create(int max_fds)
+{
+    BackendImpl *b = calloc(1, sizeof(BackendImpl));
+    if (!b)
+    {
+        return NULL;
+    }
+
+    b->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (b->epfd < 0)
+    {
+        free(b);
+        return NULL;
+    }
+
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, max_fds, sizeof(FdSlot)) < 0)
+    {
+        close(b->epfd);
+        free(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+void backend_destroy(BackendImpl *b)
+{
+    close(b->epfd);
+    free(b->slots);
+    free(b->pending);
+    free(b->events);
+    free(b);
+}
+
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, fd, sizeof(FdSlot)) < 0)
+    {
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    slot->udata = udata;
+    slot->wanted = to_epoll(events);
+    slot->armed = 0;
+    slot->registered = 1;
+
+    /* Registered with epoll at the next wait */
+    return queue_change(b, fd);
+}
+
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    slot->udata = udata;
+    slot->wanted = to_epoll(events);
+    return queue_change(b, fd);
+}
+
+int backend_unregister(BackendImpl *b, int fd)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    if (slot->armed && epoll_ctl(b->epfd, EPOLL_CTL_DEL, fd, NULL) < 0)
+    {
+        return -1;
+    }
+
+    slot->registered = 0;
+    slot->armed = 0;
+    slot->udata = NULL;
+    return 0;
+}
+
+void backend_close(BackendImpl *b, int fd)
+{
+    /* close() drops the fd from epoll, no EPOLL_CTL_DEL needed */
+    if (fd >= 0 && fd < b->nslots)
+    {
+        FdSlot *slot = &b->slots[fd];
+        slot->registered = 0;
+        slot->armed = 0;
+        slot->udata = NULL;
+    }
+
+    close(fd);
+}
+
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms)
+{
+    int out = flush_changes(b, events, max_events);
+    if (out == max_events)
+    {
+        return out;
+    }
+
+    if (b->events_capacity < max_events)
+    {
+        struct epoll_event *grown = realloc(b->events, (size_t)max_events * sizeof(*grown));
+        if (!grown)
+        {
+            return -1;
+        }
+        b->events = grown;
+        b->events_capacity = max_events;
+    }
+
+    /* Failures to report: collect whatever is ready without blocking */
+    int nev = epoll_wait(b->epfd, b->events, max_events - out, out ? 0 : timeout_ms);
+    if (nev < 0)
+    {
+        return out ? out : -1;
+    }
+
+    for (int i = 0; i < nev; i++)
+    {
+        int fd = b->events[i].data.fd;
+        uint32_t ev = b->events[i].events;
+        FdSlot *slot = &b->slots[fd];
+
+        /* Defensive: fd no longer registered */
+        if (!slot->registered)
+            continue;
+
+        unsigned flags = 0;
+        if (ev & EPOLLIN)
+            flags |= kEbRead;
+        if (ev & EPOLLOUT)
+            flags |= kEbWrite;
+        if (ev & (EPOLLERR | EPOLLHUP))
+            flags |= kEbError;
+
+        events[out].udata = slot->udata;
+        events[out].events = flags;
+        out++;
+    }
+
+    return out;
+}
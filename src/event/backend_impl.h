@@ -0,0 +1,32 @@
+#ifndef BACKEND_IMPL_H
+#define BACKEND_IMPL_H
+
+/**
+ * Interface between event_backend.c and the backend_*.c files
+ *
+ * Each backend_*.c defines struct BackendImpl and these functions;
+ * exactly one of them is linked into a binary.
+ */
+
+#include "event_backend.h"
+
+typedef struct BackendImpl BackendImpl;
+
+extern const char *const kBackendName;
+
+BackendImpl *backend_create(int max_fds);
+void backend_destroy(BackendImpl *b);
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata);
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata);
+int backend_unregister(BackendImpl *b, int fd);
+void backend_close(BackendImpl *b, int fd);
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms);
+
+/**
+ * Grow an fd-indexed table so that fd is a valid index
+ *
+ * New entries are zeroed. Returns 0 on success, -1 on allocation failure.
+ */
+int backend_table_reserve(void **table, int *capacity, int fd, size_t elem_size);
+
+#endif /* BACKEND_IMPL_H */
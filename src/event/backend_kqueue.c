@@ -0,0 +1,354 @@
+/**
+ * Event Backend - kqueue (BSD/macOS)
+ *
+ * Filter changes are queued and submitted as the changelist of the next
+ * kevent() wait, so registrations cost no syscalls of their own. Turning
+ * an interest off uses EV_DISABLE rather than EV_DELETE, and close()
+ * drops every filter of the fd, so eb_close() only has to purge queued
+ * changes.
+ */
+
+#include "backend_impl.h"
+
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const char *const kBackendName = "kqueue";
+
+enum
+{
+    kMaxChanges = 1024, /* Pending filter changes per wait */
+};
+
+typedef struct
+{
+    void *udata;
+    unsigned added; /* Filters added to the kqueue (kEbRead/kEbWrite) */
+    unsigned enabled;
+    int registered;
+} FdSlot;
+
+struct BackendImpl
+{
+    int kq;
+    FdSlot *slots; /* Indexed by fd */
+    int nslots;
+
+    /* Filter changes submitted as the changelist of the next wait */
+    struct kevent changes[kMaxChanges];
+    int nchanges;
+
+    /* Early flush: one receipt per change, and the fds whose change failed,
+       reported as kEbError by the next wait */
+    struct kevent receipts[kMaxChanges];
+    int failed[kMaxChanges];
+    int nfailed;
+
+    struct kevent *events;
+    int events_capacity;
+};
+
+/**
+ * Submit the queued changes without waiting
+ *
+ * Without an eventlist kevent() stops at the first change that fails.
+ * EV_RECEIPT makes it apply every change and return one EV_ERROR entry
+ * for each (data 0 on success) instead of dequeuing pending events.
+ */
+static void flush_changes(BackendImpl *b)
+{
+    static const struct timespec zero;
+
+    for (int i = 0; i < b->nchanges; i++)
+    {
+        b->changes[i].flags |= EV_RECEIPT;
+    }
+
+    int n = kevent(b->kq, b->changes, b->nchanges, b->receipts, b->nchanges, &zero);
+    if (n < 0)
+    {
+        perror("kevent flush");
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if ((b->receipts[i].flags & EV_ERROR) && b->receipts[i].data != 0 &&
+            b->nfailed < kMaxChanges)
+        {
+            fprintf(stderr, "EV_ERROR: %s\n", strerror((int)b->receipts[i].data));
+            b->failed[b->nfailed++] = (int)b->receipts[i].ident;
+        }
+    }
+
+    b->nchanges = 0;
+}
+
+/**
+ * Queue a filter change for the next kevent() wait
+ */
+static void queue_change(BackendImpl *b, int fd, short filter, unsigned short flags, void *udata)
+{
+    /* Full: submit what we have without waiting */
+    if (b->nchanges == kMaxChanges)
+    {
+        flush_changes(b);
+    }
+
+    EV_SET(&b->changes[b->nchanges], fd, filter, flags, 0, 0, udata);
+    b->nchanges++;
+}
+
+/**
+ * Drop queued changes and unreported failures for an fd, preserving
+ * order of the rest
+ */
+static void purge_changes(BackendImpl *b, int fd)
+{
+    int kept = 0;
+
+    for (int i = 0; i < b->nchanges; i++)
+    {
+        if (b->changes[i].ident != (uintptr_t)fd)
+        {
+            b->changes[kept++] = b->changes[i];
+        }
+    }
+
+    b->nchanges = kept;
+
+    kept = 0;
+    for (int i = 0; i < b->nfailed; i++)
+    {
+        if (b->failed[i] != fd)
+        {
+            b->failed[kept++] = b->failed[i];
+        }
+    }
+
+    b->nfailed = kept;
+}
+
+/**
+ * Queue the filter changes that move fd to the wanted interest
+ */
+static void apply_interest(BackendImpl *b, int fd, unsigned events)
+{
+    FdSlot *slot = &b->slots[fd];
+    static const struct
+    {
+        unsigned bit;
+        short filter;
+    } filters[] = {{kEbRead, EVFILT_READ}, {kEbWrite, EVFILT_WRITE}};
+
+    for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+    {
+        unsigned bit = filters[i].bit;
+
+        if ((events & bit) && !(slot->enabled & bit))
+        {
+            /* EV_ADD also refreshes udata on an existing filter */
+            queue_change(b, fd, filters[i].filter, EV_ADD | EV_ENABLE, slot->udata);
+            slot->added |= bit;
+            slot->enabled |= bit;
+        }
+        else if (!(events & bit) && (slot->enabled & bit))
+        {
+            queue_change(b, fd, filters[i].filter, EV_DISABLE, slot->udata);
+            slot->enabled &= ~bit;
+        }
+    }
+}
+
+BackendImpl *backend_create(int max_fds)
+{
+    BackendImpl *b = calloc(1, sizeof(BackendImpl));
+    if (!b)
+    {
+        return NULL;
+    }
+
+    b->kq = kqueue();
+    if (b->kq < 0)
+    {
+        free(b);
+        return NULL;
+    }
+
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, max_fds, sizeof(FdSlot)) < 0)
+    {
+        close(b->kq);
+        free(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+void backend_destroy(BackendImpl *b)
+{
+    close(b->kq);
+    free(b->slots);
+    free(b->events);
+    free(b);
+}
+
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, fd, sizeof(FdSlot)) < 0)
+    {
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    slot->udata = udata;
+    slot->added = 0;
+    slot->enabled = 0;
+    slot->registered = 1;
+
+    /* Registered by the next wait */
+    apply_interest(b, fd, events);
+    return 0;
+}
+
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    if (slot->udata != udata)
+    {
+        /* Disable filters the new interest drops: left enabled they would
+           keep firing under the old udata */
+        apply_interest(b, fd, slot->enabled & events);
+
+        /* Re-add the rest so they carry the new udata */
+        slot->udata = udata;
+        slot->enabled = 0;
+    }
+
+    apply_interest(b, fd, events);
+    return 0;
+}
+
+int backend_unregister(BackendImpl *b, int fd)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    purge_changes(b, fd);
+
+    if (slot->added & kEbRead)
+        queue_change(b, fd, EVFILT_READ, EV_DELETE, NULL);
+    if (slot->added & kEbWrite)
+        queue_change(b, fd, EVFILT_WRITE, EV_DELETE, NULL);
+
+    slot->registered = 0;
+    slot->udata = NULL;
+    return 0;
+}
+
+void backend_close(BackendImpl *b, int fd)
+{
+    /*
+     * close() removes the fd's filters from the kqueue, but changes
+     * still queued for it must go too: the fd number and its udata may
+     * both be reused before the next wait.
+     */
+    if (fd >= 0 && fd < b->nslots)
+    {
+        purge_changes(b, fd);
+        b->slots[fd].registered = 0;
+        b->slots[fd].udata = NULL;
+    }
+
+    close(fd);
+}
+
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms)
+{
+    if (b->events_capacity < max_events)
+    {
+        struct kevent *grown = realloc(b->events, (size_t)max_events * sizeof(*grown));
+        if (!grown)
+        {
+            return -1;
+        }
+        b->events = grown;
+        b->events_capacity = max_events;
+    }
+
+    /* Changes that failed in an early flush come first, without blocking */
+    int out = 0;
+    while (out < max_events && b->nfailed > 0)
+    {
+        int fd = b->failed[--b->nfailed];
+        if (fd < b->nslots && b->slots[fd].registered)
+        {
+            events[out].udata = b->slots[fd].udata;
+            events[out].events = kEbError;
+            out++;
+        }
+    }
+    if (out > 0)
+    {
+        timeout_ms = 0;
+    }
+
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+
+    /* Pending registrations ride along with the wait */
+    int nev = kevent(b->kq, b->changes, b->nchanges,
+                     b->events, max_events - out, timeout_ms < 0 ? NULL : &ts);
+    if (nev < 0)
+    {
+        /* Changes are idempotent adds/enables, safe to resubmit */
+        return out > 0 ? out : -1;
+    }
+    b->nchanges = 0;
+
+    for (int i = 0; i < nev; i++)
+    {
+        struct kevent *ev = &b->events[i];
+        int fd = (int)ev->ident;
+
+        if (ev->flags & EV_ERROR)
+        {
+            /* A queued registration failed: let the caller drop it */
+            fprintf(stderr, "EV_ERROR: %s\n", strerror((int)ev->data));
+            if (fd < b->nslots && b->slots[fd].registered)
+            {
+                events[out].udata = b->slots[fd].udata;
+                events[out].events = kEbError;
+                out++;
+            }
+            continue;
+        }
+
+        /* Defensive: fd no longer registered under this udata */
+        if (fd >= b->nslots || !b->slots[fd].registered || b->slots[fd].udata != ev->udata)
+            continue;
+
+        events[out].udata = ev->udata;
+        events[out].events = ev->filter == EVFILT_WRITE ? kEbWrite : kEbRead;
+        out++;
+    }
+
+    return out;
+}
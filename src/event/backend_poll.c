@@ -0,0 +1,199 @@
+/**
+ * Event Backend - poll()
+ *
+ * Dense pollfd array maintained incrementally (swap-remove on
+ * unregister), with an fd -> slot map, so register/modify/unregister are
+ * O(1) and a wait costs O(registered) in the kernel but only until the
+ * last ready entry in user space.
+ */
+
+#include "backend_impl.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *const kBackendName = "poll";
+
+struct BackendImpl
+{
+    struct pollfd *pollfds; /* Dense readiness set */
+    void **udata;           /* udata[i] belongs to pollfds[i] */
+    int npollfds;
+    int capacity;
+
+    int *index; /* Indexed by fd: slot in pollfds + 1, 0 = not registered */
+    int nindex;
+};
+
+static short to_poll(unsigned events)
+{
+    short ev = 0;
+
+    if (events & kEbRead)
+        ev |= POLLIN;
+    if (events & kEbWrite)
+        ev |= POLLOUT;
+
+    return ev;
+}
+
+static int slot_of(BackendImpl *b, int fd)
+{
+    if (fd < 0 || fd >= b->nindex || b->index[fd] == 0)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    return b->index[fd] - 1;
+}
+
+static int grow(BackendImpl *b)
+{
+    int capacity = b->capacity ? b->capacity * 2 : 64;
+
+    struct pollfd *pollfds = realloc(b->pollfds, (size_t)capacity * sizeof(struct pollfd));
+    if (!pollfds)
+    {
+        return -1;
+    }
+    b->pollfds = pollfds;
+
+    void **udata = realloc(b->udata, (size_t)capacity * sizeof(void *));
+    if (!udata)
+    {
+        return -1;
+    }
+    b->udata = udata;
+
+    b->capacity = capacity;
+    return 0;
+}
+
+BackendImpl *backend_create(int max_fds)
+{
+    BackendImpl *b = calloc(1, sizeof(BackendImpl));
+    if (!b)
+    {
+        return NULL;
+    }
+
+    if (backend_table_reserve((void **)&b->index, &b->nindex, max_fds, sizeof(int)) < 0)
+    {
+        free(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+void backend_destroy(BackendImpl *b)
+{
+    free(b->pollfds);
+    free(b->udata);
+    free(b->index);
+    free(b);
+}
+
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (backend_table_reserve((void **)&b->index, &b->nindex, fd, sizeof(int)) < 0)
+    {
+        return -1;
+    }
+
+    if (b->index[fd] != 0)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    if (b->npollfds == b->capacity && grow(b) < 0)
+    {
+        return -1;
+    }
+
+    /* Append to the readiness set */
+    int i = b->npollfds++;
+    b->pollfds[i].fd = fd;
+    b->pollfds[i].events = to_poll(events);
+    b->pollfds[i].revents = 0;
+    b->udata[i] = udata;
+    b->index[fd] = i + 1;
+    return 0;
+}
+
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    int i = slot_of(b, fd);
+    if (i < 0)
+    {
+        return -1;
+    }
+
+    b->pollfds[i].events = to_poll(events);
+    b->udata[i] = udata;
+    return 0;
+}
+
+int backend_unregister(BackendImpl *b, int fd)
+{
+    int i = slot_of(b, fd);
+    if (i < 0)
+    {
+        return -1;
+    }
+
+    /* Swap-remove: the last entry takes over slot i */
+    int last = --b->npollfds;
+    if (i != last)
+    {
+        b->pollfds[i] = b->pollfds[last];
+        b->udata[i] = b->udata[last];
+        b->index[b->pollfds[i].fd] = i + 1;
+    }
+    b->index[fd] = 0;
+    return 0;
+}
+
+void backend_close(BackendImpl *b, int fd)
+{
+    backend_unregister(b, fd);
+    close(fd);
+}
+
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms)
+{
+    int ready = poll(b->pollfds, b->npollfds, timeout_ms);
+    if (ready < 0)
+    {
+        return -1;
+    }
+
+    /* Stop scanning once every ready entry is seen */
+    int out = 0;
+    for (int i = 0; i < b->npollfds && ready > 0 && out < max_events; i++)
+    {
+        short revents = b->pollfds[i].revents;
+        if (!revents)
+            continue;
+
+        ready--;
+
+        unsigned flags = 0;
+        if (revents & POLLIN)
+            flags |= kEbRead;
+        if (revents & POLLOUT)
+            flags |= kEbWrite;
+        if (revents & (POLLERR | POLLHUP | POLLNVAL))
+            flags |= kEbError;
+
+        events[out].udata = b->udata[i];
+        events[out].events = flags;
+        out++;
+    }
+
+    return out;
+}
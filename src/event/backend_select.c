@@ -0,0 +1,177 @@
+/**
+ * Event Backend - select()
+ *
+ * Baseline for comparison: master fd_sets are copied into the call on
+ * every wait and the result is scanned up to the highest fd, so a wait
+ * is O(max fd) and fds must stay below FD_SETSIZE.
+ */
+
+#include "backend_impl.h"
+
+#include <sys/select.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *const kBackendName = "select";
+
+struct BackendImpl
+{
+    fd_set read_set; /* Master interest sets */
+    fd_set write_set;
+    int max_fd;      /* Highest registered fd, -1 = none */
+
+    void *udata[FD_SETSIZE];
+    unsigned char registered[FD_SETSIZE];
+};
+
+static int check_fd(int fd)
+{
+    if (fd < 0 || fd >= FD_SETSIZE)
+    {
+        errno = fd < 0 ? EBADF : EMFILE;
+        return -1;
+    }
+    return 0;
+}
+
+static void set_interest(BackendImpl *b, int fd, unsigned events)
+{
+    if (events & kEbRead)
+        FD_SET(fd, &b->read_set);
+    else
+        FD_CLR(fd, &b->read_set);
+
+    if (events & kEbWrite)
+        FD_SET(fd, &b->write_set);
+    else
+        FD_CLR(fd, &b->write_set);
+}
+
+BackendImpl *backend_create(int max_fds)
+{
+    (void)max_fds; /* Fixed FD_SETSIZE tables */
+
+    BackendImpl *b = calloc(1, sizeof(BackendImpl));
+    if (!b)
+    {
+        return NULL;
+    }
+
+    FD_ZERO(&b->read_set);
+    FD_ZERO(&b->write_set);
+    b->max_fd = -1;
+    return b;
+}
+
+void backend_destroy(BackendImpl *b)
+{
+    free(b);
+}
+
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (check_fd(fd) < 0)
+    {
+        return -1;
+    }
+
+    if (b->registered[fd])
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    b->registered[fd] = 1;
+    b->udata[fd] = udata;
+    set_interest(b, fd, events);
+
+    if (fd > b->max_fd)
+        b->max_fd = fd;
+
+    return 0;
+}
+
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (check_fd(fd) < 0 || !b->registered[fd])
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    b->udata[fd] = udata;
+    set_interest(b, fd, events);
+    return 0;
+}
+
+int backend_unregister(BackendImpl *b, int fd)
+{
+    if (check_fd(fd) < 0 || !b->registered[fd])
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    b->registered[fd] = 0;
+    b->udata[fd] = NULL;
+    FD_CLR(fd, &b->read_set);
+    FD_CLR(fd, &b->write_set);
+
+    /* Lower the scan bound past trailing free fds */
+    while (b->max_fd >= 0 && !b->registered[b->max_fd])
+        b->max_fd--;
+
+    return 0;
+}
+
+void backend_close(BackendImpl *b, int fd)
+{
+    backend_unregister(b, fd);
+    close(fd);
+}
+
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms)
+{
+    fd_set rset = b->read_set;
+    fd_set wset = b->write_set;
+    struct timeval tv;
+
+    if (timeout_ms >= 0)
+    {
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    }
+
+    int ready = select(b->max_fd + 1, &rset, &wset, NULL, timeout_ms < 0 ? NULL : &tv);
+    if (ready < 0)
+    {
+        return -1;
+    }
+
+    int out = 0;
+    for (int fd = 0; fd <= b->max_fd && ready > 0 && out < max_events; fd++)
+    {
+        unsigned flags = 0;
+
+        if (FD_ISSET(fd, &rset))
+        {
+            flags |= kEbRead;
+            ready--;
+        }
+        if (FD_ISSET(fd, &wset))
+        {
+            flags |= kEbWrite;
+            ready--;
+        }
+
+        if (flags)
+        {
+            events[out].udata = b->udata[fd];
+            events[out].events = flags;
+            out++;
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,317 @@
+/**
+ * Event Backend - io_uring (Linux)
+ *
+ * Readiness through one-shot IORING_OP_POLL_ADD requests. A poll is
+ * re-armed at the next wait after its completion was handed out, which
+ * gives the same level-triggered behaviour as the other backends: if
+ * the fd is still ready, the new poll completes right away.
+ *
+ * Arms, re-arms and removals are only queued as SQEs; the wait submits
+ * all of them and reaps completions in a single io_uring_enter().
+ *
+ * user_data carries fd and a per-fd generation, so completions of polls
+ * that were removed (or whose fd was closed and reused) are discarded.
+ */
+
+#include "backend_impl.h"
+#include "../common/uring.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *const kBackendName = "io_uring";
+
+enum
+{
+    kRingEntries = 4096, /* Submission queue depth */
+};
+
+/* Completions of POLL_REMOVE requests themselves */
+#define IGNORE_USER_DATA UINT64_MAX
+
+typedef struct
+{
+    void *udata;
+    unsigned events;   /* Wanted interest */
+    uint32_t gen;      /* Bumped whenever an in-flight poll is abandoned */
+    int registered;
+    int armed;         /* Poll request in flight */
+    int queued;        /* In BackendImpl.rearm */
+} FdSlot;
+
+struct BackendImpl
+{
+    Ring ring;
+    FdSlot *slots; /* Indexed by fd */
+    int nslots;
+
+    /* Fds to (re)arm at the next wait */
+    int *rearm;
+    int nrearm;
+    int rearm_capacity;
+};
+
+static uint64_t make_user_data(int fd, uint32_t gen)
+{
+    return ((uint64_t)gen << 32) | (uint32_t)fd;
+}
+
+static unsigned to_poll(unsigned events)
+{
+    unsigned mask = 0;
+
+    if (events & kEbRead)
+        mask |= POLLIN;
+    if (events & kEbWrite)
+        mask |= POLLOUT;
+
+    return mask;
+}
+
+static int queue_rearm(BackendImpl *b, int fd)
+{
+    FdSlot *slot = &b->slots[fd];
+
+    if (slot->queued)
+    {
+        return 0;
+    }
+
+    if (b->nrearm == b->rearm_capacity)
+    {
+        int capacity = b->rearm_capacity ? b->rearm_capacity * 2 : 256;
+        int *grown = realloc(b->rearm, (size_t)capacity * sizeof(int));
+        if (!grown)
+        {
+            return -1;
+        }
+        b->rearm = grown;
+        b->rearm_capacity = capacity;
+    }
+
+    slot->queued = 1;
+    b->rearm[b->nrearm++] = fd;
+    return 0;
+}
+
+/**
+ * Queue removal of fd's in-flight poll and orphan its completion
+ */
+static void cancel_poll(BackendImpl *b, int fd)
+{
+    FdSlot *slot = &b->slots[fd];
+
+    if (slot->armed)
+    {
+        struct io_uring_sqe *sqe = ring_get_sqe(&b->ring);
+        if (sqe)
+        {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = make_user_data(fd, slot->gen);
+            sqe->user_data = IGNORE_USER_DATA;
+        }
+        slot->armed = 0;
+    }
+
+    slot->gen++;
+}
+
+/**
+ * Queue POLL_ADD for every registered fd that has no poll in flight
+ */
+static void arm_pending(BackendImpl *b)
+{
+    int kept = 0;
+
+    for (int i = 0; i < b->nrearm; i++)
+    {
+        int fd = b->rearm[i];
+        FdSlot *slot = &b->slots[fd];
+
+        if (!slot->registered || slot->armed || !slot->events)
+        {
+            slot->queued = 0;
+            continue;
+        }
+
+        struct io_uring_sqe *sqe = ring_get_sqe(&b->ring);
+        if (!sqe)
+        {
+            /* Ring full: retry at the next wait */
+            b->rearm[kept++] = fd;
+            continue;
+        }
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = to_poll(slot->events);
+        sqe->user_data = make_user_data(fd, slot->gen);
+        slot->armed = 1;
+        slot->queued = 0;
+    }
+
+    b->nrearm = kept;
+}
+
+BackendImpl *backend_create(int max_fds)
+{
+    BackendImpl *b = calloc(1, sizeof(BackendImpl));
+    if (!b)
+    {
+        return NULL;
+    }
+
+    if (ring_init(&b->ring, kRingEntries) < 0)
+    {
+        free(b);
+        return NULL;
+    }
+
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, max_fds, sizeof(FdSlot)) < 0)
+    {
+        ring_destroy(&b->ring);
+        free(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+void backend_destroy(BackendImpl *b)
+{
+    ring_destroy(&b->ring);
+    free(b->slots);
+    free(b->rearm);
+    free(b);
+}
+
+int backend_register(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (backend_table_reserve((void **)&b->slots, &b->nslots, fd, sizeof(FdSlot)) < 0)
+    {
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    if (slot->registered)
+    {
+        errno = EEXIST;
+        return -1;
+    }
+
+    slot->udata = udata;
+    slot->events = events;
+    slot->registered = 1;
+
+    /* Armed by the next wait */
+    return queue_rearm(b, fd);
+}
+
+int backend_modify(BackendImpl *b, int fd, unsigned events, void *udata)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    FdSlot *slot = &b->slots[fd];
+    slot->udata = udata; /* Looked up on completion, not stored in the ring */
+
+    if (slot->events == events)
+    {
+        return 0;
+    }
+
+    slot->events = events;
+    cancel_poll(b, fd);
+    return queue_rearm(b, fd);
+}
+
+int backend_unregister(BackendImpl *b, int fd)
+{
+    if (fd < 0 || fd >= b->nslots || !b->slots[fd].registered)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    cancel_poll(b, fd);
+    b->slots[fd].registered = 0;
+    b->slots[fd].udata = NULL;
+    return 0;
+}
+
+void backend_close(BackendImpl *b, int fd)
+{
+    /* An in-flight poll pins the file, so it must be removed explicitly */
+    backend_unregister(b, fd);
+    close(fd);
+}
+
+int backend_wait(BackendImpl *b, EbEvent *events, int max_events, int timeout_ms)
+{
+    Ring *ring = &b->ring;
+
+    arm_pending(b);
+
+    if (ring_enter_timeout(ring, 1, timeout_ms) < 0)
+    {
+        return -1;
+    }
+
+    /* Reap completions, leaving any beyond max_events for the next wait */
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    int out = 0;
+
+    while (head != tail && out < max_events)
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        head++;
+
+        if (user_data == IGNORE_USER_DATA)
+            continue;
+
+        int fd = (int)(uint32_t)user_data;
+        uint32_t gen = (uint32_t)(user_data >> 32);
+
+        /* Removed, modified or closed since it was armed */
+        if (fd >= b->nslots || !b->slots[fd].registered || b->slots[fd].gen != gen)
+            continue;
+
+        FdSlot *slot = &b->slots[fd];
+        slot->armed = 0;
+
+        unsigned flags = 0;
+        if (res < 0)
+        {
+            flags = kEbError;
+        }
+        else
+        {
+            if (res & POLLIN)
+                flags |= kEbRead;
+            if (res & POLLOUT)
+                flags |= kEbWrite;
+            if (res & (POLLERR | POLLHUP | POLLNVAL))
+                flags |= kEbError;
+        }
+
+        events[out].udata = slot->udata;
+        events[out].events = flags;
+        out++;
+
+        /* Level-triggered: poll again once the caller has had its turn */
+        queue_rearm(b, fd);
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    return out;
+}
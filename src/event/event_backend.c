@@ -0,0 +1,131 @@
+/**
+ * Event Backend - implementation-independent part
+ *
+ * Owns the timing wheel and turns it into the wait timeout; everything
+ * else is forwarded to the linked backend_*.c.
+ */
+
+#include "event_backend.h"
+#include "backend_impl.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct EventBackend
+{
+    BackendImpl *impl;
+    TimerWheel timers;
+};
+
+EventBackend *eb_create(int max_fds)
+{
+    EventBackend *eb = calloc(1, sizeof(EventBackend));
+    if (!eb)
+    {
+        return NULL;
+    }
+
+    eb->impl = backend_create(max_fds);
+    if (!eb->impl)
+    {
+        free(eb);
+        return NULL;
+    }
+
+    timer_wheel_init(&eb->timers, timer_now_ms());
+    return eb;
+}
+
+void eb_destroy(EventBackend *eb)
+{
+    if (!eb)
+        return;
+
+    backend_destroy(eb->impl);
+    free(eb);
+}
+
+const char *eb_name(void)
+{
+    return kBackendName;
+}
+
+int eb_register(EventBackend *eb, int fd, unsigned events, void *udata)
+{
+    return backend_register(eb->impl, fd, events, udata);
+}
+
+int eb_modify(EventBackend *eb, int fd, unsigned events, void *udata)
+{
+    return backend_modify(eb->impl, fd, events, udata);
+}
+
+int eb_unregister(EventBackend *eb, int fd)
+{
+    return backend_unregister(eb->impl, fd);
+}
+
+void eb_close(EventBackend *eb, int fd)
+{
+    backend_close(eb->impl, fd);
+}
+
+int eb_wait(EventBackend *eb, EbEvent *events, int max_events, int max_timeout_ms)
+{
+    int timeout = timer_wheel_timeout_ms(&eb->timers, timer_now_ms());
+
+    if (max_timeout_ms >= 0 && (timeout < 0 || max_timeout_ms < timeout))
+    {
+        timeout = max_timeout_ms;
+    }
+
+    return backend_wait(eb->impl, events, max_events, timeout);
+}
+
+void eb_timer_schedule(EventBackend *eb, TimerNode *node, uint64_t timeout_ms)
+{
+    timer_wheel_schedule(&eb->timers, node, timer_now_ms(), timeout_ms);
+}
+
+void eb_timer_cancel(EventBackend *eb, TimerNode *node)
+{
+    timer_wheel_cancel(&eb->timers, node);
+}
+
+size_t eb_expire(EventBackend *eb, TimerNode *expired)
+{
+    return timer_wheel_advance(&eb->timers, timer_now_ms(), expired);
+}
+
+int backend_table_reserve(void **table, int *capacity, int fd, size_t elem_size)
+{
+    if (fd < 0)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (fd < *capacity)
+    {
+        return 0;
+    }
+
+    int new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity <= fd)
+    {
+        new_capacity *= 2;
+    }
+
+    void *grown = realloc(*table, (size_t)new_capacity * elem_size);
+    if (!grown)
+    {
+        return -1;
+    }
+
+    memset((char *)grown + (size_t)*capacity * elem_size, 0,
+           (size_t)(new_capacity - *capacity) * elem_size);
+    *table = grown;
+    *capacity = new_capacity;
+    return 0;
+}
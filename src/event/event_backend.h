@@ -0,0 +1,120 @@
+#ifndef EVENT_BACKEND_H
+#define EVENT_BACKEND_H
+
+/**
+ * Event Backend
+ *
+ * Small readiness API shared by the event loops (aio, the event server
+ * and the thread server's keep-alive poller). Exactly one
+ * implementation (select, poll, epoll, kqueue or io_uring) is linked
+ * into each binary, chosen at build time with BACKEND=... in the
+ * Makefile, so calls are direct with no dispatch overhead.
+ *
+ * Semantics are level-triggered on every backend: an fd that is still
+ * readable/writable after being handled is reported again by the next
+ * eb_wait(). Registration changes may be deferred and applied by the
+ * next eb_wait(), which lets kqueue/epoll/io_uring batch them.
+ *
+ * The backend also owns the connection timing wheel, so the wait
+ * timeout always matches the nearest timer tick.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../common/timer_wheel.h"
+
+/* Interest and event flags */
+enum
+{
+    kEbRead = 1 << 0,
+    kEbWrite = 1 << 1,
+    kEbError = 1 << 2, /* Reported only: error/hangup or failed registration */
+};
+
+/* One readiness event */
+typedef struct
+{
+    void *udata;     /* Pointer given at registration */
+    unsigned events; /* kEbRead | kEbWrite | kEbError */
+} EbEvent;
+
+typedef struct EventBackend EventBackend;
+
+/**
+ * Create a backend instance
+ *
+ * @param max_fds Expected number of registered fds (sizing hint)
+ * @return        Backend, or NULL on failure (errno set)
+ */
+EventBackend *eb_create(int max_fds);
+
+/**
+ * Destroy a backend instance (registered fds are not closed)
+ */
+void eb_destroy(EventBackend *eb);
+
+/**
+ * Name of the linked implementation, e.g. "epoll"
+ */
+const char *eb_name(void);
+
+/**
+ * Start watching fd for the given interest
+ *
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int eb_register(EventBackend *eb, int fd, unsigned events, void *udata);
+
+/**
+ * Change the interest (and udata) of a registered fd
+ *
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int eb_modify(EventBackend *eb, int fd, unsigned events, void *udata);
+
+/**
+ * Stop watching fd; the fd stays open
+ *
+ * @return 0 on success, -1 on failure (errno set)
+ */
+int eb_unregister(EventBackend *eb, int fd);
+
+/**
+ * Stop watching fd and close it
+ *
+ * Cheaper than eb_unregister + close on backends where close() already
+ * drops the registration (epoll, kqueue).
+ */
+void eb_close(EventBackend *eb, int fd);
+
+/**
+ * Apply deferred registrations and wait for events
+ *
+ * Blocks until an event arrives, the next timer tick is due, or
+ * max_timeout_ms elapses (-1 = no extra limit, 0 = do not block).
+ *
+ * @return Number of events stored, or -1 on failure (errno set)
+ */
+int eb_wait(EventBackend *eb, EbEvent *events, int max_events, int max_timeout_ms);
+
+/**
+ * (Re)arm a timer on the backend's wheel, timeout_ms from now
+ *
+ * Safe to call while dispatching events: the deadline does not depend
+ * on when eb_expire() last ran.
+ */
+void eb_timer_schedule(EventBackend *eb, TimerNode *node, uint64_t timeout_ms);
+
+/**
+ * Disarm a timer; no-op if it is not scheduled
+ */
+void eb_timer_cancel(EventBackend *eb, TimerNode *node);
+
+/**
+ * Move every due timer onto expired (see timer_wheel_list_pop)
+ *
+ * @return Number of expired timers
+ */
+size_t eb_expire(EventBackend *eb, TimerNode *expired);
+
+#endif /* EVENT_BACKEND_H */
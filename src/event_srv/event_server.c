@@ -0,0 +1,1624 @@
+/**
+ * Event-driven HTTP Server Implementation
+ *
+ * Connection pool and state machine on top of the event backend API
+ * (src/event), so the same request handling runs on select, poll,
+ * epoll, kqueue or io_uring readiness depending on the build.
+ *
+ * Design goals:
+ * - Handle C10K+ concurrent connections
+ * - Efficient event-driven I/O, one loop per reactor
+ * - Zero-copy where possible
+ * - Memory efficient connection management
+ */
+
+#include "event_server.h"
+#include "../common/http.h"
+#include "../common/util.h"
+#include "../common/timer_wheel.h"
+#include "../event/event_backend.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <assert.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+/* Configuration */
+enum
+{
+    kMaxEvents = 1024,           /* Events to process per iteration - increased */
+    kMaxConnections = 50000,     /* Support up to 50K connections */
+    kRequestBufferSize = 4096,   /* HTTP request buffer - reduced */
+    kResponseBufferSize = 32768, /* Response chunk size - reduced */
+    kPathBufferSize = 1024,      /* File path buffer - reduced */
+    kHeaderBufferSize = 512,     /* HTTP header buffer */
+    kListenBacklog = 10000,      /* Listen queue size - match somaxconn */
+    kMaxReactors = 256,          /* Upper bound for --reactors */
+    kStatsIntervalSec = 10,      /* Aggregated stats print interval */
+    kIdleTimeoutMs = 5000,       /* No request bytes yet */
+    kHeaderTimeoutMs = 10000,    /* First byte to complete headers */
+    kSendTimeoutMs = 10000,      /* Max gap between send progress */
+    kKeepAliveTimeoutMs = 5000,  /* Idle between keep-alive requests */
+    kKeepAliveMax = 100,         /* Requests per connection */
+    kLingerTimeoutMs = 2000,     /* Discarding input after the last response */
+    kHandoffRingSize = 4096,     /* Acceptor -> worker queue, power of 2 */
+    kMaxBusyPollUs = 1000000,    /* Upper bound for the spin budget */
+};
+
+/*
+ * Stats are written only by the owning reactor and read by the stats
+ * printer on reactor 0. Relaxed atomics keep those reads tear-free
+ * without a locked instruction on the hot path.
+ */
+#define STAT_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+#define STAT_READ(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/* Connection states */
+typedef enum
+{
+    STATE_READING_REQUEST,
+    STATE_PROCESSING,
+    STATE_SENDING_RESPONSE,
+    STATE_CLOSING
+} ConnectionState;
+
+/* Connection structure */
+typedef struct Connection
+{
+    int fd;
+    ConnectionState state;
+
+    /* Request handling */
+    char *request_buffer;
+    size_t request_size;
+    size_t request_capacity;
+    http_parser_t *parser; /* Same allocation as request_buffer */
+    int keep_alive;        /* Cleared once the closing response is queued */
+    int requests;          /* Answered so far, for kKeepAliveMax */
+
+    /* Response queue: headers and bodies back to back */
+    char *response_buffer;
+    size_t response_size;
+    size_t response_sent;
+
+    /* File serving */
+    int file_fd;
+    off_t file_offset;
+    off_t file_size;
+
+    /* Idle/header/send deadline */
+    TimerNode timer;
+
+    /* For connection pool */
+    struct Connection *next;
+
+    /* Server context */
+    struct Server *server;
+} Connection;
+
+/*
+ * Single-producer/single-consumer fd queue from the acceptor thread to
+ * one worker. head and tail sit on separate cache lines so the two
+ * sides do not false-share.
+ */
+typedef struct
+{
+    _Alignas(64) uint32_t head; /* Next slot to pop, written by the worker */
+    _Alignas(64) uint32_t tail; /* Next slot to push, written by the acceptor */
+    _Alignas(64) int fds[kHandoffRingSize];
+} HandoffRing;
+
+/*
+ * Server context
+ *
+ * One per reactor. Each reactor owns its event backend, its own
+ * SO_REUSEPORT listener and its slice of the connection pool, so the
+ * event loops share nothing on the hot path. In acceptor mode there is
+ * no per-reactor listener; connections arrive through the handoff ring.
+ */
+typedef struct Server
+{
+    int id;               /* Reactor index */
+    EventBackend *eb;     /* Readiness backend, also owns the timers */
+    int listen_fd;        /* Listening socket */
+    const char *doc_root; /* Document root */
+    pthread_t thread;     /* Loop thread (reactor 0 runs on the caller) */
+    int busy_poll_us;     /* Spin budget before a blocking wait, 0 = off */
+    int cpu;              /* CPU the loop thread is pinned to, -1 = none */
+
+    /* Connection pool */
+    Connection *connections; /* Array of this reactor's connections */
+    Connection *free_list;   /* Free connection list */
+    int max_connections;     /* Pool slice size */
+    int num_active;          /* Active connections count */
+    int pool_ready;          /* Free list built by the loop thread */
+
+    /* Statistics */
+    uint64_t total_requests;
+    uint64_t total_bytes_sent;
+    uint64_t total_connections;
+    uint64_t total_timeouts;
+
+    /* Loop time: spinning on empty non-blocking waits vs. blocked */
+    uint64_t spin_us;
+    uint64_t sleep_us;
+    uint64_t spin_hits; /* Waits that found events while spinning */
+    uint64_t sleeps;    /* Blocking waits */
+
+    /* Acceptor mode: fds handed over by the acceptor thread */
+    HandoffRing *handoff; /* NULL when the reactor has its own listener */
+    int wakeup_fd;        /* eventfd, or pipe read end off Linux */
+    int wakeup_write_fd;  /* Same as wakeup_fd for an eventfd */
+
+    /* Reactor group, for stats aggregation on reactor 0 */
+    struct Server *group;
+    int group_size;
+} Server;
+
+/* Function prototypes */
+static uint64_t now_us(void);
+static int wait_events(Server *server, EbEvent *events, int max_events);
+static int reactor_init(Server *server, const char *bind_addr, int port);
+static void pool_init(Server *server);
+static int reactor_run(Server *server);
+static int handoff_init(Server *server);
+static void handoff_cleanup(Server *server);
+static int handoff_push(HandoffRing *ring, int fd);
+static uint32_t handoff_pending(HandoffRing *ring);
+static void handoff_drain(Server *server);
+static void wakeup_signal(Server *server);
+static int acceptor_loop(Server *workers, int num_workers, int listen_fd);
+static void reactor_cleanup(Server *server);
+static void *reactor_thread(void *arg);
+static int event_loop(Server *server);
+static void print_stats(Server *server);
+static void expire_connections(Server *server);
+static int increase_fd_limit(void);
+static int create_listen_socket(const char *bind_addr, int port);
+static Connection *alloc_connection(Server *server);
+static void free_connection(Server *server, Connection *conn);
+static void reset_connection(Connection *conn);
+static void close_connection(Server *server, Connection *conn);
+static int accept_connections(Server *server);
+static int add_connection(Server *server, int fd);
+static int handle_read_event(Server *server, Connection *conn);
+static int handle_write_event(Server *server, Connection *conn);
+static int serve_connection(Server *server, Connection *conn);
+static int queue_responses(Server *server, Connection *conn);
+static int linger_close(Server *server, Connection *conn);
+static int process_request(Server *server, Connection *conn, const char *buf,
+                           const http_req_t *request);
+static int prepare_file_response(Connection *conn, const char *file_path);
+static int prepare_error_response(Connection *conn, int status_code);
+static int fill_from_file(Connection *conn);
+static int send_response(Connection *conn);
+
+/**
+ * Main server entry point
+ */
+int run_event_server(const char *bind_addr, int port, const char *doc_root)
+{
+    return run_event_server_reactors(bind_addr, port, doc_root, 1);
+}
+
+/**
+ * Multi-reactor entry point
+ */
+int run_event_server_reactors(const char *bind_addr, int port,
+                              const char *doc_root, int num_reactors)
+{
+    EventServerOptions opts = {.num_reactors = num_reactors};
+    return run_event_server_opts(bind_addr, port, doc_root, &opts);
+}
+
+/**
+ * Acceptor-thread entry point
+ */
+int run_event_server_acceptor(const char *bind_addr, int port,
+                              const char *doc_root, int num_workers)
+{
+    EventServerOptions opts = {.num_reactors = num_workers, .use_acceptor = 1};
+    return run_event_server_opts(bind_addr, port, doc_root, &opts);
+}
+
+/**
+ * Start the reactors, either each with its own SO_REUSEPORT listener or
+ * all fed by one acceptor thread on the caller
+ */
+int run_event_server_opts(const char *bind_addr, int port, const char *doc_root,
+                          const EventServerOptions *opts)
+{
+    int num_reactors = opts->num_reactors;
+    int use_acceptor = opts->use_acceptor;
+
+    if (!doc_root)
+    {
+        fprintf(stderr, "Error: document root required\n");
+        return -1;
+    }
+
+    if (num_reactors < 1 || num_reactors > kMaxReactors)
+    {
+        fprintf(stderr, "Error: reactors must be between 1 and %d\n", kMaxReactors);
+        return -1;
+    }
+
+    if (opts->busy_poll_us < 0 || opts->busy_poll_us > kMaxBusyPollUs)
+    {
+        fprintf(stderr, "Error: busy poll budget must be between 0 and %d us\n",
+                kMaxBusyPollUs);
+        return -1;
+    }
+
+    /* Increase file descriptor limit for C10K+ */
+    if (increase_fd_limit() < 0)
+    {
+        fprintf(stderr, "Warning: Could not increase fd limit\n");
+    }
+
+    /* Ignore SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Acceptor mode: one shared listener, drained on this thread */
+    int listen_fd = -1;
+    if (use_acceptor)
+    {
+        listen_fd = create_listen_socket(bind_addr, port);
+        if (listen_fd < 0)
+        {
+            return -1;
+        }
+    }
+
+    /* Initialize reactors */
+    Server *reactors = calloc(num_reactors, sizeof(Server));
+    if (!reactors)
+    {
+        perror("calloc");
+        if (listen_fd >= 0)
+            close(listen_fd);
+        return -1;
+    }
+
+    for (int i = 0; i < num_reactors; i++)
+    {
+        reactors[i].id = i;
+        reactors[i].doc_root = doc_root;
+        reactors[i].max_connections = kMaxConnections / num_reactors;
+        reactors[i].busy_poll_us = opts->busy_poll_us;
+        reactors[i].cpu = opts->num_cpus > 0 ? opts->cpus[i % opts->num_cpus] : -1;
+        reactors[i].group = reactors;
+        reactors[i].group_size = num_reactors;
+
+        int ok = use_acceptor ? reactor_init(&reactors[i], NULL, -1)
+                              : reactor_init(&reactors[i], bind_addr, port);
+        if (ok < 0)
+        {
+            while (--i >= 0)
+                reactor_cleanup(&reactors[i]);
+            free(reactors);
+            if (listen_fd >= 0)
+                close(listen_fd);
+            return -1;
+        }
+    }
+
+    /*
+     * Listeners join the SO_REUSEPORT group in reactor order, so group
+     * index i is reactor i: steer each connection to the reactor pinned
+     * to the CPU that took the packet
+     */
+    if (!use_acceptor && opts->num_cpus > 0 && num_reactors > 1)
+    {
+        int socket_cpus[kMaxReactors];
+        for (int i = 0; i < num_reactors; i++)
+            socket_cpus[i] = reactors[i].cpu;
+
+        if (attach_reuseport_cpu_steering(reactors[0].listen_fd, socket_cpus, num_reactors) < 0)
+        {
+            perror("Warning: SO_ATTACH_REUSEPORT_CBPF");
+        }
+    }
+
+    fprintf(stderr, "Event server (%s) listening on %s:%d (doc_root: %s)\n",
+            eb_name(), bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
+    fprintf(stderr, "Reactors: %d%s, max connections: %d per reactor\n",
+            num_reactors, use_acceptor ? " + acceptor thread" : "",
+            reactors[0].max_connections);
+    if (opts->busy_poll_us > 0)
+    {
+        fprintf(stderr, "Busy poll: spin up to %d us before sleeping\n", opts->busy_poll_us);
+    }
+    if (opts->num_cpus > 0)
+    {
+        fprintf(stderr, "Pinning: %d reactors over %d CPUs\n", num_reactors, opts->num_cpus);
+    }
+
+    /*
+     * Reactors 1..N-1 get their own threads and reactor 0 runs here,
+     * unless the acceptor needs this thread.
+     */
+    int first = use_acceptor ? 0 : 1;
+    int started = first;
+    for (; started < num_reactors; started++)
+    {
+        if (pthread_create(&reactors[started].thread, NULL,
+                           reactor_thread, &reactors[started]) != 0)
+        {
+            fprintf(stderr, "Failed to create reactor thread %d\n", started);
+            break;
+        }
+    }
+
+    int ret;
+    if (use_acceptor)
+    {
+        /* Workers that failed to start must not be handed connections */
+        ret = started > 0 ? acceptor_loop(reactors, started, listen_fd) : -1;
+    }
+    else
+    {
+        ret = reactor_run(&reactors[0]);
+    }
+
+    /* Cleanup */
+    for (int i = first; i < started; i++)
+    {
+        pthread_join(reactors[i].thread, NULL);
+    }
+    for (int i = 0; i < num_reactors; i++)
+    {
+        reactor_cleanup(&reactors[i]);
+    }
+    free(reactors);
+    if (listen_fd >= 0)
+        close(listen_fd);
+
+    return ret;
+}
+
+/**
+ * Create a reactor's event backend, listener and connection pool
+ *
+ * A negative port means acceptor mode: the reactor gets a handoff ring
+ * and wakeup fd instead of a listener.
+ */
+static int reactor_init(Server *server, const char *bind_addr, int port)
+{
+    /* Create event backend */
+    server->eb = eb_create(server->max_connections + 16);
+    if (!server->eb)
+    {
+        perror("eb_create");
+        return -1;
+    }
+
+    /* Create listening socket (SO_REUSEPORT lets every reactor bind) */
+    server->listen_fd = -1;
+    if (port >= 0)
+    {
+        server->listen_fd = create_listen_socket(bind_addr, port);
+        if (server->listen_fd < 0)
+        {
+            eb_destroy(server->eb);
+            return -1;
+        }
+    }
+    else if (handoff_init(server) < 0)
+    {
+        eb_destroy(server->eb);
+        return -1;
+    }
+
+    /*
+     * Reserve the connection pool; pool_init() builds the free list on
+     * the loop thread, so with pinning the pages are first touched, and
+     * therefore placed, on that CPU's NUMA node
+     */
+    server->connections = calloc(server->max_connections, sizeof(Connection));
+    if (!server->connections)
+    {
+        perror("calloc");
+        handoff_cleanup(server);
+        if (server->listen_fd >= 0)
+            close(server->listen_fd);
+        eb_destroy(server->eb);
+        return -1;
+    }
+
+    /*
+     * Register listen socket (NULL udata marks the listener), or the
+     * wakeup fd (udata = handoff ring) in acceptor mode
+     */
+    int ret = server->handoff
+                  ? eb_register(server->eb, server->wakeup_fd, kEbRead, server->handoff)
+                  : eb_register(server->eb, server->listen_fd, kEbRead, NULL);
+    if (ret < 0)
+    {
+        perror("eb_register");
+        free(server->connections);
+        handoff_cleanup(server);
+        if (server->listen_fd >= 0)
+            close(server->listen_fd);
+        eb_destroy(server->eb);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Release a reactor's connections, listener and event backend
+ */
+static void reactor_cleanup(Server *server)
+{
+    for (int i = 0; server->pool_ready && i < server->max_connections; i++)
+    {
+        if (server->connections[i].fd >= 0)
+        {
+            close(server->connections[i].fd);
+        }
+        free(server->connections[i].parser);
+        free(server->connections[i].response_buffer);
+    }
+    free(server->connections);
+    handoff_cleanup(server);
+    if (server->listen_fd >= 0)
+        close(server->listen_fd);
+    eb_destroy(server->eb);
+}
+
+/**
+ * Set up the handoff ring and wakeup fd of an acceptor-mode worker
+ */
+static int handoff_init(Server *server)
+{
+    server->handoff = aligned_alloc(64, sizeof(HandoffRing));
+    if (!server->handoff)
+    {
+        perror("aligned_alloc");
+        return -1;
+    }
+    memset(server->handoff, 0, sizeof(HandoffRing));
+
+#ifdef __linux__
+    server->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->wakeup_write_fd = server->wakeup_fd;
+    if (server->wakeup_fd < 0)
+    {
+        perror("eventfd");
+        free(server->handoff);
+        server->handoff = NULL;
+        return -1;
+    }
+#else
+    int fds[2];
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        free(server->handoff);
+        server->handoff = NULL;
+        return -1;
+    }
+    set_nonblock(fds[0]);
+    set_nonblock(fds[1]);
+    server->wakeup_fd = fds[0];
+    server->wakeup_write_fd = fds[1];
+#endif
+
+    return 0;
+}
+
+/**
+ * Release a worker's handoff ring, closing fds never picked up
+ */
+static void handoff_cleanup(Server *server)
+{
+    HandoffRing *ring = server->handoff;
+    if (!ring)
+        return;
+
+    for (uint32_t i = ring->head; i != ring->tail; i++)
+    {
+        close(ring->fds[i & (kHandoffRingSize - 1)]);
+    }
+
+    close(server->wakeup_fd);
+    if (server->wakeup_write_fd != server->wakeup_fd)
+        close(server->wakeup_write_fd);
+
+    free(ring);
+    server->handoff = NULL;
+}
+
+/**
+ * Queue an fd for a worker (acceptor side)
+ */
+static int handoff_push(HandoffRing *ring, int fd)
+{
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head == kHandoffRingSize)
+    {
+        return -1; /* Full */
+    }
+
+    ring->fds[tail & (kHandoffRingSize - 1)] = fd;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Fds queued but not yet picked up by the worker (acceptor side)
+ */
+static uint32_t handoff_pending(HandoffRing *ring)
+{
+    return ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Wake a worker after queueing fds for it (acceptor side)
+ */
+static void wakeup_signal(Server *server)
+{
+#ifdef __linux__
+    uint64_t one = 1;
+#else
+    char one = 1;
+#endif
+
+    /* EAGAIN: counter/pipe already signalled, the worker will wake */
+    if (write(server->wakeup_write_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        perror("wakeup write");
+    }
+}
+
+/**
+ * Take over every fd the acceptor queued (worker side)
+ */
+static void handoff_drain(Server *server)
+{
+    HandoffRing *ring = server->handoff;
+    char buf[64];
+
+    /* Reset the wakeup before popping so a later push wakes us again */
+    while (read(server->wakeup_fd, buf, sizeof(buf)) > 0)
+    {
+    }
+
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail)
+    {
+        int fd = ring->fds[head & (kHandoffRingSize - 1)];
+        head++;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+        add_connection(server, fd);
+    }
+}
+
+/**
+ * Acceptor thread: drain the listen queue and hand each connection to
+ * the worker with the fewest active plus queued connections
+ *
+ * Least-loaded placement keeps long-lived connections from piling up
+ * on one loop, which SO_REUSEPORT hashing cannot avoid.
+ */
+static int acceptor_loop(Server *workers, int num_workers, int listen_fd)
+{
+    EventBackend *eb = eb_create(16);
+    if (!eb || eb_register(eb, listen_fd, kEbRead, NULL) < 0)
+    {
+        perror("acceptor");
+        eb_destroy(eb);
+        return -1;
+    }
+
+    EbEvent events[1];
+    unsigned char notify[kMaxReactors];
+
+    while (1)
+    {
+        if (eb_wait(eb, events, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("eb_wait");
+            break;
+        }
+
+        memset(notify, 0, (size_t)num_workers);
+
+        while (1)
+        {
+            /* Non-blocking and TCP_NODELAY come with the socket */
+            int fd = accept_nonblock(listen_fd);
+            if (fd < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    perror("accept");
+                break;
+            }
+
+            Server *best = &workers[0];
+            uint32_t best_load = UINT32_MAX;
+            for (int i = 0; i < num_workers; i++)
+            {
+                uint32_t load = (uint32_t)STAT_READ(workers[i].num_active) +
+                                handoff_pending(workers[i].handoff);
+                if (load < best_load)
+                {
+                    best = &workers[i];
+                    best_load = load;
+                }
+            }
+
+            if (handoff_push(best->handoff, fd) < 0)
+            {
+                close(fd); /* Every ring is backed up */
+                continue;
+            }
+            notify[best->id] = 1;
+        }
+
+        /* One wakeup per worker per accept burst */
+        for (int i = 0; i < num_workers; i++)
+        {
+            if (notify[i])
+                wakeup_signal(&workers[i]);
+        }
+    }
+
+    eb_destroy(eb);
+    return -1;
+}
+
+/**
+ * Reactor thread entry point
+ */
+static void *reactor_thread(void *arg)
+{
+    reactor_run((Server *)arg);
+    return NULL;
+}
+
+/**
+ * Pin the calling thread, build the pool on it and run the loop
+ */
+static int reactor_run(Server *server)
+{
+    if (server->cpu >= 0 && pin_current_thread(server->cpu) < 0)
+    {
+        fprintf(stderr, "Warning: reactor %d not pinned to CPU %d: %s\n",
+                server->id, server->cpu, strerror(errno));
+    }
+
+    pool_init(server);
+    return event_loop(server);
+}
+
+/**
+ * Build the free list of the reactor's connection pool
+ */
+static void pool_init(Server *server)
+{
+    for (int i = 0; i < server->max_connections - 1; i++)
+    {
+        server->connections[i].next = &server->connections[i + 1];
+        server->connections[i].fd = -1;
+    }
+    server->connections[server->max_connections - 1].fd = -1;
+    server->free_list = &server->connections[0];
+    server->pool_ready = 1;
+}
+
+/**
+ * Event loop of one reactor
+ */
+static int event_loop(Server *server)
+{
+    EbEvent events[kMaxEvents];
+    int running = 1;
+
+    while (running)
+    {
+        /* Applies queued registrations, then waits until the next tick */
+        int nev = wait_events(server, events, kMaxEvents);
+
+        if (nev < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("eb_wait");
+            return -1;
+        }
+
+        /* Process events */
+        for (int i = 0; i < nev; i++)
+        {
+            EbEvent *ev = &events[i];
+            Connection *conn = (Connection *)ev->udata;
+
+            if (server->handoff && ev->udata == server->handoff)
+            {
+                /* Connections from the acceptor thread */
+                handoff_drain(server);
+                continue;
+            }
+
+            if (!conn)
+            {
+                /* New connection */
+                accept_connections(server);
+                continue;
+            }
+
+            /* Client I/O; skip if closed by an earlier event this batch */
+            if (conn->fd < 0)
+                continue;
+
+            if (ev->events & kEbError)
+            {
+                close_connection(server, conn);
+                continue;
+            }
+
+            if (ev->events & kEbRead)
+            {
+                if (handle_read_event(server, conn) < 0)
+                {
+                    close_connection(server, conn);
+                    continue;
+                }
+            }
+
+            if (ev->events & kEbWrite)
+            {
+                if (handle_write_event(server, conn) < 0)
+                {
+                    close_connection(server, conn);
+                }
+            }
+        }
+
+        /* Reclaim connections whose deadline passed */
+        expire_connections(server);
+
+        /* Reactor 0 prints aggregated stats periodically */
+        if (server->id == 0)
+        {
+            print_stats(server);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Monotonic clock in microseconds, for loop time accounting
+ */
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * Wait for events, spinning first if busy polling is enabled
+ *
+ * In busy-poll mode the loop re-polls without blocking for up to
+ * busy_poll_us, so a request arriving shortly after the last one is
+ * picked up without a sleep/wakeup round trip. Only once the budget is
+ * spent does it fall back to a blocking wait.
+ */
+static int wait_events(Server *server, EbEvent *events, int max_events)
+{
+    uint64_t start = now_us();
+    int nev = 0;
+
+    if (server->busy_poll_us > 0)
+    {
+        uint64_t now = start;
+
+        do
+        {
+            nev = eb_wait(server->eb, events, max_events, 0);
+            now = now_us();
+        } while (nev == 0 && now - start < (uint64_t)server->busy_poll_us);
+
+        STAT_ADD(server->spin_us, now - start);
+        if (nev != 0)
+        {
+            if (nev > 0)
+                STAT_ADD(server->spin_hits, 1);
+            return nev;
+        }
+        start = now;
+    }
+
+    nev = eb_wait(server->eb, events, max_events, -1);
+    STAT_ADD(server->sleep_us, now_us() - start);
+    STAT_ADD(server->sleeps, 1);
+    return nev;
+}
+
+/**
+ * Print stats summed over all reactors
+ */
+static void print_stats(Server *server)
+{
+    static time_t last_stats = 0;
+    static int max_active = 0;
+    time_t now = time(NULL);
+
+    int active = 0;
+    uint64_t connections = 0, requests = 0, bytes = 0, timeouts = 0;
+    uint64_t spin_us = 0, sleep_us = 0, spin_hits = 0, sleeps = 0;
+
+    for (int i = 0; i < server->group_size; i++)
+    {
+        Server *r = &server->group[i];
+        active += STAT_READ(r->num_active);
+        connections += STAT_READ(r->total_connections);
+        requests += STAT_READ(r->total_requests);
+        bytes += STAT_READ(r->total_bytes_sent);
+        timeouts += STAT_READ(r->total_timeouts);
+        spin_us += STAT_READ(r->spin_us);
+        sleep_us += STAT_READ(r->sleep_us);
+        spin_hits += STAT_READ(r->spin_hits);
+        sleeps += STAT_READ(r->sleeps);
+    }
+
+    if (active > max_active)
+        max_active = active;
+
+    if (now - last_stats >= kStatsIntervalSec)
+    {
+        fprintf(stderr, "Stats: reactors=%d active=%d max=%d total=%llu requests=%llu bytes=%llu timeouts=%llu "
+                        "spin_ms=%llu sleep_ms=%llu spin_hits=%llu sleeps=%llu\n",
+                server->group_size,
+                active,
+                max_active,
+                (unsigned long long)connections,
+                (unsigned long long)requests,
+                (unsigned long long)bytes,
+                (unsigned long long)timeouts,
+                (unsigned long long)(spin_us / 1000),
+                (unsigned long long)(sleep_us / 1000),
+                (unsigned long long)spin_hits,
+                (unsigned long long)sleeps);
+        last_stats = now;
+    }
+}
+
+/**
+ * Close every connection whose deadline has passed, in one batch
+ */
+static void expire_connections(Server *server)
+{
+    TimerNode expired;
+    timer_wheel_list_init(&expired);
+
+    if (eb_expire(server->eb, &expired) == 0)
+    {
+        return;
+    }
+
+    TimerNode *node;
+    while ((node = timer_wheel_list_pop(&expired)) != NULL)
+    {
+        Connection *conn = timer_entry(node, Connection, timer);
+        STAT_ADD(server->total_timeouts, 1);
+        close_connection(server, conn);
+    }
+}
+
+/**
+ * Increase file descriptor limit for C10K+
+ */
+static int increase_fd_limit(void)
+{
+    struct rlimit rlim;
+
+    /* Get current limits */
+    if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        return -1;
+    }
+
+    /* Try to set to maximum */
+    rlim.rlim_cur = rlim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        /* Try a reasonable value */
+        rlim.rlim_cur = 65536;
+        rlim.rlim_max = 65536;
+        if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+        {
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "File descriptor limit: %llu\n",
+            (unsigned long long)rlim.rlim_cur);
+    return 0;
+}
+
+/**
+ * Create and configure listening socket
+ */
+static int create_listen_socket(const char *bind_addr, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    /* Set non-blocking */
+    if (set_nonblock(fd) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    /* Allow address reuse */
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("SO_REUSEADDR");
+        close(fd);
+        return -1;
+    }
+
+#ifdef SO_REUSEPORT
+    /* Allow port reuse (load balancing) */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        /* Non-fatal */
+    }
+#endif
+
+    /* Accepted sockets inherit TCP_NODELAY from the listener */
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    /* Bind */
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = bind_addr ? inet_addr(bind_addr) : INADDR_ANY};
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    /* Listen */
+    if (listen(fd, kListenBacklog) < 0)
+    {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Allocate connection from pool
+ */
+static Connection *alloc_connection(Server *server)
+{
+    if (!server->free_list)
+    {
+        return NULL; /* Pool exhausted */
+    }
+
+    Connection *conn = server->free_list;
+    server->free_list = conn->next;
+    conn->next = NULL;
+
+    reset_connection(conn);
+    STAT_ADD(server->num_active, 1);
+    STAT_ADD(server->total_connections, 1);
+
+    return conn;
+}
+
+/**
+ * Return connection to pool
+ */
+static void free_connection(Server *server, Connection *conn)
+{
+    eb_timer_cancel(server->eb, &conn->timer);
+
+    if (conn->fd >= 0)
+    {
+        eb_close(server->eb, conn->fd);
+        conn->fd = -1;
+    }
+
+    if (conn->file_fd >= 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+    }
+
+    conn->next = server->free_list;
+    server->free_list = conn;
+    STAT_ADD(server->num_active, -1);
+}
+
+/**
+ * Reset connection state
+ */
+static void reset_connection(Connection *conn)
+{
+    conn->state = STATE_READING_REQUEST;
+    conn->request_size = 0;
+    conn->keep_alive = 1;
+    conn->requests = 0;
+    conn->response_size = 0;
+    conn->response_sent = 0;
+    conn->file_fd = -1;
+    conn->file_offset = 0;
+    conn->file_size = 0;
+}
+
+/**
+ * Close connection and cleanup
+ */
+static void close_connection(Server *server, Connection *conn)
+{
+    /* eb_close() drops the fd and any registration still queued for it */
+    free_connection(server, conn);
+}
+
+/**
+ * Accept new connections
+ */
+static int accept_connections(Server *server)
+{
+    while (1)
+    {
+        /* Non-blocking and TCP_NODELAY come with the socket */
+        int fd = accept_nonblock(server->listen_fd);
+        if (fd < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break; /* No more connections */
+            }
+            perror("accept");
+            break;
+        }
+
+        add_connection(server, fd);
+    }
+
+    return 0;
+}
+
+/**
+ * Take ownership of an accepted fd and start reading its request
+ */
+static int add_connection(Server *server, int fd)
+{
+    /* Get connection from pool */
+    Connection *conn = alloc_connection(server);
+    if (!conn)
+    {
+        close(fd); /* Pool exhausted */
+        return -1;
+    }
+
+    /* Initialize connection */
+    conn->fd = fd;
+    conn->server = server;
+
+    if (server->busy_poll_us > 0)
+    {
+        set_busy_poll(fd, server->busy_poll_us);
+    }
+
+    /* Allocate buffers on demand - lazy allocation saves memory */
+    if (!conn->request_buffer)
+    {
+        conn->parser = malloc(sizeof(http_parser_t) + kRequestBufferSize);
+        if (!conn->parser)
+        {
+            free_connection(server, conn);
+            return -1;
+        }
+        conn->request_buffer = (char *)(conn->parser + 1);
+        conn->request_capacity = kRequestBufferSize;
+    }
+    http_parser_init(conn->parser);
+
+    /* Batching backends apply this at the next wait */
+    if (eb_register(server->eb, fd, kEbRead, conn) < 0)
+    {
+        free_connection(server, conn);
+        return -1;
+    }
+    eb_timer_schedule(server->eb, &conn->timer, kIdleTimeoutMs);
+
+    return 0;
+}
+
+/**
+ * Handle read events
+ */
+static int handle_read_event(Server *server, Connection *conn)
+{
+    if (conn->state == STATE_CLOSING)
+    {
+        /* Discard until the client closes too */
+        ssize_t n = recv(conn->fd, conn->request_buffer, conn->request_capacity, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        return n > 0 ? 0 : -1;
+    }
+
+    if (conn->state != STATE_READING_REQUEST)
+    {
+        return 0;
+    }
+
+    /* Read request */
+    ssize_t n = recv(conn->fd,
+                     conn->request_buffer + conn->request_size,
+                     conn->request_capacity - conn->request_size - 1, 0);
+
+    if (n <= 0)
+    {
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0; /* Try again later */
+        }
+        return -1; /* Connection closed or error */
+    }
+
+    /* Header deadline runs from the first byte and is not extended */
+    if (conn->request_size == 0)
+    {
+        eb_timer_schedule(server->eb, &conn->timer, kHeaderTimeoutMs);
+    }
+
+    conn->request_size += n;
+
+    /*
+     * Optimistic inline write: most responses fit in the socket send
+     * buffer, so send right away and only wait for writability if the
+     * socket pushes back.
+     */
+    return serve_connection(server, conn);
+}
+
+/**
+ * Handle write events
+ */
+static int handle_write_event(Server *server, Connection *conn)
+{
+    if (conn->state != STATE_SENDING_RESPONSE)
+    {
+        return 0;
+    }
+
+    return serve_connection(server, conn);
+}
+
+/**
+ * Answer buffered requests and flush their responses
+ *
+ * Each time the output buffer drains it is refilled with the next chunk
+ * of the file in flight and the responses to every complete request
+ * behind it, then sent with one send(). Pipelined requests thus cost
+ * one syscall per buffer rather than one or two per response.
+ *
+ * @return 0 if the connection stays open, -1 to close it
+ */
+static int serve_connection(Server *server, Connection *conn)
+{
+    int sent = 0;
+
+    while (1)
+    {
+        if (conn->response_sent == conn->response_size)
+        {
+            conn->response_size = 0;
+            conn->response_sent = 0;
+
+            if (conn->file_fd >= 0 && fill_from_file(conn) < 0)
+            {
+                return -1;
+            }
+            if (queue_responses(server, conn) < 0)
+            {
+                return -1;
+            }
+            if (conn->response_size == 0)
+            {
+                break; /* Nothing left to answer */
+            }
+        }
+
+        int ret = send_response(conn);
+        if (ret < 0)
+        {
+            return -1;
+        }
+        if (ret == 0)
+        {
+            /* Socket buffer full: wait for writability */
+            if (conn->state != STATE_SENDING_RESPONSE)
+            {
+                if (eb_modify(server->eb, conn->fd, kEbWrite, conn) < 0)
+                {
+                    return -1;
+                }
+                conn->state = STATE_SENDING_RESPONSE;
+            }
+            return 0;
+        }
+        sent = 1;
+    }
+
+    /* The response that closes the connection is out */
+    if (!conn->keep_alive)
+    {
+        return linger_close(server, conn);
+    }
+
+    if (conn->state != STATE_READING_REQUEST)
+    {
+        if (eb_modify(server->eb, conn->fd, kEbRead, conn) < 0)
+        {
+            return -1;
+        }
+        conn->state = STATE_READING_REQUEST;
+    }
+
+    /* Idle until the next request, or finish the one partly buffered */
+    if (sent)
+    {
+        eb_timer_schedule(server->eb, &conn->timer,
+                          conn->request_size == 0 ? kKeepAliveTimeoutMs : kHeaderTimeoutMs);
+    }
+    return 0;
+}
+
+/**
+ * Close after the final response without losing it to a RST
+ *
+ * Closing a socket with unread input makes the kernel reset the
+ * connection, and the client may drop the response it has not read yet
+ * (e.g. a 400 or 413 sent mid-request, or the last of kKeepAliveMax with
+ * more requests still in flight). Send FIN instead and discard what still
+ * arrives until the client closes or kLingerTimeoutMs passes.
+ *
+ * @return 0 while lingering, -1 to close now
+ */
+static int linger_close(Server *server, Connection *conn)
+{
+    if (shutdown(conn->fd, SHUT_WR) < 0)
+    {
+        return -1;
+    }
+
+    if (conn->state != STATE_READING_REQUEST &&
+        eb_modify(server->eb, conn->fd, kEbRead, conn) < 0)
+    {
+        return -1;
+    }
+
+    conn->request_size = 0;
+    conn->state = STATE_CLOSING;
+    eb_timer_schedule(server->eb, &conn->timer, kLingerTimeoutMs);
+    return 0;
+}
+
+/**
+ * Parse every complete buffered request and queue its response
+ *
+ * Stops at a response whose file does not fit in the output buffer, so
+ * later responses queue behind its body in order, and when there is no
+ * room left for another header. Consumed requests are compacted out of
+ * the request buffer; a partial one keeps its parser state.
+ *
+ * @return 0 on success, -1 if a response could not be queued
+ */
+static int queue_responses(Server *server, Connection *conn)
+{
+    size_t start = 0;
+    int ret = 0;
+
+    while (conn->keep_alive && conn->file_fd < 0 &&
+           kResponseBufferSize - conn->response_size >= kHeaderBufferSize)
+    {
+        /* Only the new bytes are scanned; a complete header fills parser->req */
+        const char *buf = conn->request_buffer + start;
+        int parsed = http_parser_execute(conn->parser, buf, conn->request_size - start);
+        if (parsed == 0)
+        {
+            /* Check buffer overflow */
+            if (start == 0 && conn->request_size >= conn->request_capacity - 1)
+            {
+                ret = prepare_error_response(conn, 413); /* Request Too Large */
+            }
+            break;
+        }
+        if (parsed < 0)
+        {
+            ret = prepare_error_response(conn, 400); /* Bad Request */
+            break;
+        }
+
+        /* The last request allowed on this connection says so */
+        conn->keep_alive = conn->parser->req.keep_alive && conn->requests + 1 < kKeepAliveMax;
+        conn->requests++;
+        ret = process_request(server, conn, buf, &conn->parser->req);
+        if (ret < 0)
+        {
+            break;
+        }
+
+        /* Small files go out with their header */
+        if (conn->file_fd >= 0 && fill_from_file(conn) < 0)
+        {
+            return -1;
+        }
+
+        start += conn->parser->pos;
+        http_parser_init(conn->parser);
+    }
+
+    if (start > 0)
+    {
+        conn->request_size -= start;
+        memmove(conn->request_buffer, conn->request_buffer + start, conn->request_size);
+    }
+    return ret;
+}
+
+/**
+ * Process HTTP request
+ */
+static int process_request(Server *server, Connection *conn, const char *buf,
+                           const http_req_t *request)
+{
+    char file_path[kPathBufferSize];
+
+    /* Build file path */
+    if (http_safe_join(file_path, sizeof(file_path),
+                       server->doc_root, buf + request->target.off,
+                       request->target.len) < 0)
+    {
+        return prepare_error_response(conn, 404); /* Not Found */
+    }
+
+    /* Check file */
+    struct stat st;
+    if (stat(file_path, &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        return prepare_error_response(conn, 404); /* Not Found */
+    }
+
+    /* Prepare response */
+    if (prepare_file_response(conn, file_path) < 0)
+    {
+        return prepare_error_response(conn, 500); /* Internal Server Error */
+    }
+
+    STAT_ADD(server->total_requests, 1);
+    return 0;
+}
+
+/**
+ * Prepare file response
+ */
+static int prepare_file_response(Connection *conn, const char *file_path)
+{
+    /* Open file */
+    conn->file_fd = open(file_path, O_RDONLY);
+    if (conn->file_fd < 0)
+    {
+        return -1;
+    }
+
+    /* Get file size */
+    struct stat st;
+    if (fstat(conn->file_fd, &st) < 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+        return -1;
+    }
+
+    /* Allocate response buffer if needed */
+    if (!conn->response_buffer)
+    {
+        conn->response_buffer = malloc(kResponseBufferSize);
+        if (!conn->response_buffer)
+        {
+            close(conn->file_fd);
+            conn->file_fd = -1;
+            return -1;
+        }
+    }
+
+    /* Queue header behind earlier responses; the body follows it */
+    int header_len = http_build_200(conn->response_buffer + conn->response_size,
+                                    kResponseBufferSize - conn->response_size, st.st_size,
+                                    http_guess_type(file_path), conn->keep_alive);
+    if (header_len < 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+        return -1;
+    }
+
+    conn->response_size += header_len;
+    conn->file_size = st.st_size;
+    conn->file_offset = 0;
+
+    return 0;
+}
+
+/**
+ * Prepare error response
+ */
+static int prepare_error_response(Connection *conn, int status_code)
+{
+    char response[kHeaderBufferSize];
+    int response_len = 0;
+
+    /* Only a 404 leaves the request stream in a known state */
+    if (status_code != 404)
+    {
+        conn->keep_alive = 0;
+    }
+
+    switch (status_code)
+    {
+    case 400:
+        response_len = snprintf(response, sizeof(response),
+                                "HTTP/1.1 400 Bad Request\r\n"
+                                "Content-Length: 11\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Bad Request");
+        break;
+
+    case 404:
+        response_len = http_build_404(response, sizeof(response), conn->keep_alive);
+        break;
+
+    case 413:
+        response_len = snprintf(response, sizeof(response),
+                                "HTTP/1.1 413 Request Entity Too Large\r\n"
+                                "Content-Length: 18\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Request Too Large");
+        break;
+
+    case 500:
+        response_len = snprintf(response, sizeof(response),
+                                "HTTP/1.1 500 Internal Server Error\r\n"
+                                "Content-Length: 21\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Internal Server Error");
+        break;
+
+    default:
+        return -1;
+    }
+
+    if (response_len <= 0 || (size_t)response_len >= sizeof(response))
+    {
+        return -1;
+    }
+
+    /* Allocate buffer if needed */
+    if (!conn->response_buffer)
+    {
+        conn->response_buffer = malloc(kResponseBufferSize);
+        if (!conn->response_buffer)
+        {
+            return -1;
+        }
+    }
+
+    /* Queue behind earlier responses */
+    memcpy(conn->response_buffer + conn->response_size, response, response_len);
+    conn->response_size += response_len;
+
+    return 0;
+}
+
+/**
+ * Read as much of the file in flight as fits behind the queued output
+ *
+ * The file is closed once its last byte is queued.
+ */
+static int fill_from_file(Connection *conn)
+{
+    size_t room = kResponseBufferSize - conn->response_size;
+    if ((off_t)room > conn->file_size - conn->file_offset)
+    {
+        room = conn->file_size - conn->file_offset;
+    }
+
+    if (room > 0)
+    {
+        ssize_t n = pread(conn->file_fd, conn->response_buffer + conn->response_size,
+                          room, conn->file_offset);
+        if (n <= 0)
+        {
+            return -1; /* Error, or the file shrank under us */
+        }
+        conn->response_size += n;
+        conn->file_offset += n;
+    }
+
+    if (conn->file_offset >= conn->file_size)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+    }
+    return 0;
+}
+
+/**
+ * Send queued response data
+ *
+ * @return 1 once the output buffer is drained, 0 if the socket pushed
+ *         back, -1 on error
+ */
+static int send_response(Connection *conn)
+{
+    ssize_t n = send(conn->fd,
+                     conn->response_buffer + conn->response_sent,
+                     conn->response_size - conn->response_sent,
+                     MSG_NOSIGNAL);
+
+    if (n <= 0)
+    {
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0; /* Try again later */
+        }
+        return -1; /* Error */
+    }
+
+    conn->response_sent += n;
+    eb_timer_schedule(conn->server->eb, &conn->timer, kSendTimeoutMs);
+    STAT_ADD(conn->server->total_bytes_sent, n);
+
+    return conn->response_sent == conn->response_size;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef EVENT_SERVER_H
+#define EVENT_SERVER_H
+
+/**
+ * Event-driven HTTP Server
+ *
+ * Single state machine on top of the event backend API; the backend
+ * (select, poll, epoll, kqueue or io_uring) is chosen at build time.
+ * Built as epoll_http on Linux and kqueue_http on BSD/macOS.
+ * Designed to handle C10K+ concurrent connections efficiently.
+ */
+
+/* Tuning knobs for run_event_server_opts() */
+typedef struct
+{
+    int num_reactors; /* Event loop threads (1 = single loop) */
+    int use_acceptor; /* Feed the loops from one acceptor thread */
+    int busy_poll_us; /* Spin on non-blocking waits this long before
+                         sleeping, and set SO_BUSY_POLL on accepted
+                         sockets; 0 = always block */
+    const int *cpus;  /* Reactor i is pinned to cpus[i % num_cpus] and
+                         allocates its pool there; NULL = unpinned */
+    int num_cpus;
+} EventServerOptions;
+
+/**
+ * Starts the event-driven HTTP server
+ * 
+ * @param bind_addr IP address to bind (NULL for INADDR_ANY)
+ * @param port      Port number to listen on
+ * @param doc_root  Document root directory path
+ * @return          0 on success, -1 on failure
+ */
+int run_event_server(const char *bind_addr, int port, const char *doc_root);
+
+/**
+ * Starts the event-driven HTTP server with one event loop per thread
+ *
+ * Each reactor owns its own SO_REUSEPORT listener, event backend,
+ * connection pool slice and stats; the kernel spreads new connections
+ * across the listeners. Stats are summed over reactors when printed.
+ *
+ * @param bind_addr    IP address to bind (NULL for INADDR_ANY)
+ * @param port         Port number to listen on
+ * @param doc_root     Document root directory path
+ * @param num_reactors Number of event loop threads (1 = single loop)
+ * @return             0 on success, -1 on failure
+ */
+int run_event_server_reactors(const char *bind_addr, int port,
+                              const char *doc_root, int num_reactors);
+
+/**
+ * Starts the event-driven HTTP server with a dedicated acceptor thread
+ *
+ * The calling thread drains one shared listener and hands each accepted
+ * fd to the worker loop with the fewest active plus queued connections,
+ * through a per-worker lock-free SPSC ring and an eventfd (pipe off
+ * Linux) wakeup. Evens out load when connection lifetimes vary, which
+ * SO_REUSEPORT hashing does not.
+ *
+ * @param bind_addr   IP address to bind (NULL for INADDR_ANY)
+ * @param port        Port number to listen on
+ * @param doc_root    Document root directory path
+ * @param num_workers Number of worker event loop threads
+ * @return            0 on success, -1 on failure
+ */
+int run_event_server_acceptor(const char *bind_addr, int port,
+                              const char *doc_root, int num_workers);
+
+/**
+ * Starts the event-driven HTTP server with explicit options
+ *
+ * With a CPU list and one listener per reactor, a classic BPF program
+ * on the SO_REUSEPORT group steers each connection to the reactor
+ * pinned to the CPU that received it.
+ *
+ * @param bind_addr IP address to bind (NULL for INADDR_ANY)
+ * @param port      Port number to listen on
+ * @param doc_root  Document root directory path
+ * @param opts      Reactor count, acceptor mode, busy polling and pinning
+ * @return          0 on success, -1 on failure
+ */
+int run_event_server_opts(const char *bind_addr, int port, const char *doc_root,
+                          const EventServerOptions *opts);
+
+#endif /* EVENT_SERVER_H */
@@ -1,7 +1,25 @@
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "aio_srv/aio_server.h"
 
-int main()
+int main(int argc, char **argv)
 {
-  return run_aio_server(NULL, 8080, "./www");
+  int max_clients = 10000;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--max-clients") == 0 && i + 1 < argc)
+    {
+      max_clients = atoi(argv[++i]);
+    }
+    else
+    {
+      fprintf(stderr, "Usage: %s [--max-clients N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  return run_aio_server_clients(NULL, 8080, "./www", max_clients);
 }
@@ -0,0 +1,37 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/util.h"
+#include "coro_srv/coro_server.h"
+
+int main(int argc, char **argv)
+{
+    CoroServerOptions opts = {0};
+    static int cpus[kMaxCpuId + 1];
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            opts.num_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cpus") == 0 && i + 1 < argc)
+        {
+            opts.num_cpus = parse_cpu_list(argv[++i], cpus, kMaxCpuId + 1);
+            if (opts.num_cpus < 0)
+            {
+                fprintf(stderr, "Invalid CPU list: %s\n", argv[i]);
+                return 1;
+            }
+            opts.cpus = cpus;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--threads N] [--cpus LIST]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    return run_coro_server_opts(NULL, 8080, "./www", &opts);
+}
@@ -0,0 +1,45 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/util.h"
+#include "event_srv/event_server.h"
+
+int main(int argc, char **argv)
+{
+    EventServerOptions opts = {.num_reactors = 1};
+    static int cpus[kMaxCpuId + 1];
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--reactors") == 0 && i + 1 < argc)
+        {
+            opts.num_reactors = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--acceptor") == 0)
+        {
+            opts.use_acceptor = 1;
+        }
+        else if (strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc)
+        {
+            opts.busy_poll_us = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cpus") == 0 && i + 1 < argc)
+        {
+            opts.num_cpus = parse_cpu_list(argv[++i], cpus, kMaxCpuId + 1);
+            if (opts.num_cpus < 0)
+            {
+                fprintf(stderr, "Invalid CPU list: %s\n", argv[i]);
+                return 1;
+            }
+            opts.cpus = cpus;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--reactors N] [--acceptor] [--busy-poll US] [--cpus LIST]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    return run_event_server_opts(NULL, 8080, "./www", &opts);
+}
@@ -1,7 +1,53 @@
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common/util.h"
 #include "thread_srv/thread_server.h"
 
-int main()
+int main(int argc, char **argv)
 {
-  return run_thread_server(NULL, 8080, "./www");
-}
\ No newline at end of file
+  ThreadServerOptions opts = {0};
+  static int cpus[kMaxCpuId + 1];
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--cpus") == 0 && i + 1 < argc)
+    {
+      opts.num_cpus = parse_cpu_list(argv[++i], cpus, kMaxCpuId + 1);
+      if (opts.num_cpus < 0)
+      {
+        fprintf(stderr, "Invalid CPU list: %s\n", argv[i]);
+        return 1;
+      }
+      opts.cpus = cpus;
+    }
+    else if (strcmp(argv[i], "--min-threads") == 0 && i + 1 < argc)
+    {
+      opts.min_threads = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+    {
+      opts.max_threads = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--work-stealing") == 0)
+    {
+      opts.work_stealing = 1;
+    }
+    else if (strcmp(argv[i], "--leader-follower") == 0)
+    {
+      opts.leader_follower = 1;
+    }
+    else if (strcmp(argv[i], "--queue-deadline") == 0 && i + 1 < argc)
+    {
+      opts.queue_deadline_ms = atoi(argv[++i]);
+    }
+    else
+    {
+      fprintf(stderr, "Usage: %s [--cpus LIST] [--min-threads N] [--max-threads N] [--work-stealing] [--leader-follower] [--queue-deadline MS]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  return run_thread_server_opts(NULL, 8080, "./www", &opts);
+}
@@ -0,0 +1,7 @@
+#include <stddef.h>
+#include "uring_srv/uring_server.h"
+
+int main()
+{
+    return run_uring_server(NULL, 8080, "./www");
+}
@@ -6,6 +6,8 @@
 #include "thread_server.h"
 #include "../common/http.h"
 #include "../common/util.h"
+#include "../common/timer_wheel.h"
+#include "../event/event_backend.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -20,13 +22,28 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/resource.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
 
 /* Configuration for C10K optimization */
 enum
 {
-    kMaxWorkerThreads = 200,       /* Optimal thread pool size */
-    kQueueSize = 10000,            /* Connection queue size */
+    kMinWorkerThreads = 8,         /* Default pool floor */
+    kMaxWorkerThreads = 200,       /* Default pool ceiling */
+    kWorkerLimit = 4096,           /* Upper bound for --max-threads */
+    kWorkerLingerMs = 10000,       /* Idle time before a worker retires */
+    kControlIntervalMs = 100,      /* Pool controller tick */
+    kGrowWaitUs = 2000,            /* Mean queue wait that counts as backlog */
+    kGrowTicks = 3,                /* Backlogged ticks in a row before growing */
+    kStatsIntervalSec = 10,        /* Stats print interval */
+    kQueueDeadlineMs = 1000,       /* Default max queue wait before shedding */
+    kQueueSize = 16384,            /* Connection queue size, power of 2 */
     kMaxRequestSize = 4096,        /* Reduced for memory efficiency */
     kMaxPathSize = 1024,           /* Path buffer */
     kMaxHeaderSize = 512,          /* Response header buffer */
@@ -35,51 +52,246 @@ enum
     kThreadStackSize = 128 * 1024, /* 128KB stack (reduced) */
     kSocketTimeoutSec = 10,        /* Shorter timeout for C10K */
     kKeepAliveMax = 100,           /* Max requests per connection */
-    kKeepAliveTimeout = 5          /* Keep-alive timeout in seconds */
+    kKeepAliveTimeout = 5,         /* Keep-alive timeout in seconds */
+    kLingerTimeoutMs = 2000,       /* Discarding input after the last response */
+    kMaxPollEvents = 1024,         /* Poller events per wait */
+    kInboxSize = 256,              /* Per-worker inbox (work stealing), power of 2 */
+    kDequeSize = 256,              /* Per-worker deque (work stealing), power of 2 */
+    kInboxBatch = 64               /* Inbox -> deque moves per refill */
 };
 
-/* Connection queue node */
-typedef struct Connection
+/*
+ * Stats are written only by the owning thread and summed by the accept
+ * loop when printed; relaxed atomics keep those reads tear-free.
+ */
+#define STAT_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+#define STAT_READ(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/* Sent as-is to connections shed under overload */
+static const char kServiceUnavailable[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Retry-After: 1\r\n"
+    "Content-Length: 19\r\n"
+    "Content-Type: text/plain\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "Service Unavailable";
+
+/*
+ * Bounded MPMC fd queue (Vyukov): each cell's sequence number says
+ * whether it is free for the producer at that position or holds a value
+ * for the consumer, so push and pop are a single CAS on their own
+ * index. Cells and indices are padded to a cache line each so
+ * neighbouring producers and consumers do not false-share.
+ */
+typedef struct
 {
+    _Alignas(64) size_t seq;
     int fd;
-    const char *doc_root;
-    struct Connection *next;
-} Connection;
+    uint64_t enqueued_us; /* For queue wait accounting, 0 = untimed */
+} QueueCell;
 
-/* Thread pool structure */
 typedef struct
 {
-    pthread_t *threads;
-    int num_threads;
+    _Alignas(64) size_t mask; /* Capacity - 1 */
+    _Alignas(64) size_t enqueue_pos;
+    _Alignas(64) size_t dequeue_pos;
+    QueueCell cells[];
+} FdQueue;
+
+/*
+ * Chase-Lev work-stealing deque of fds. Only the owning worker pushes
+ * and takes at the bottom (LIFO, cache-warm); other workers steal the
+ * oldest entry from the top with a CAS. Fixed capacity: the owner only
+ * refills it from its inbox while it is empty, in batches that fit.
+ */
+typedef struct
+{
+    int fd;
+    uint64_t enqueued_us;
+} DequeEntry;
 
-    /* Connection queue */
-    Connection *queue_head;
-    Connection *queue_tail;
-    int queue_size;
+typedef struct
+{
+    _Alignas(64) int64_t top;    /* Next entry to steal */
+    _Alignas(64) int64_t bottom; /* Next free slot, owner only */
+    _Alignas(64) DequeEntry entries[kDequeSize];
+} WorkDeque;
+
+/*
+ * Eventcount: workers sleep only after announcing themselves in
+ * waiters and re-checking the queue, so a producer skips the wakeup
+ * syscall entirely unless someone is actually asleep. seq is the futex
+ * word on Linux; elsewhere a mutex/condvar pair that is only touched on
+ * the sleep path.
+ */
+typedef struct
+{
+    _Alignas(64) uint32_t seq;
+    uint32_t waiters;
+#ifndef __linux__
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+} EventCount;
 
-    /* Synchronization */
-    pthread_mutex_t queue_mutex;
-    pthread_cond_t queue_cond;
-    bool shutdown;
+/* Per-fd state that outlives a single worker's turn */
+typedef struct
+{
+    TimerNode timer; /* Keep-alive deadline while parked */
+    int fd;
+    int requests;    /* Served so far, for kKeepAliveMax */
+    int last_worker; /* Slot that served it last, for requeue affinity */
+    bool lingering;  /* Output shut down, discarding input until EOF */
+} ConnState;
+
+/*
+ * Responses of one batch of pipelined requests, written with a single
+ * send() once no complete request is left in the read buffer. Small
+ * files are read straight into it; large ones stream through it.
+ */
+typedef struct
+{
+    int fd;
+    size_t len;
+    char data[kFileBufferSize];
+} ResponseBuffer;
+
+struct ThreadPool;
+
+/* Worker slot lifecycle, owned by the pool controller */
+typedef enum
+{
+    WORKER_IDLE_SLOT, /* No thread */
+    WORKER_RUNNING,
+    WORKER_EXITED /* Retired, waiting to be joined */
+} WorkerState;
+
+/* Per-worker thread state, one cache line of stats per thread */
+typedef struct
+{
+    struct ThreadPool *pool;
+    pthread_t thread;
+    int cpu;           /* Pinned CPU, -1 = unpinned */
+    WorkerState state;
+
+    /* Work stealing: fds routed to this worker, and its deque */
+    FdQueue *inbox;
+    WorkDeque deque;
+
+    /* Statistics, kept across the threads that reuse the slot */
+    _Alignas(64) uint64_t requests;
+    uint64_t connections;
+    uint64_t active;
+    uint64_t wait_us; /* Queue wait of the connections taken */
+    uint64_t waits;
+    uint64_t shed;    /* Taken past the queue deadline, answered 503 */
+} Worker;
+
+/* Thread pool structure */
+typedef struct ThreadPool
+{
+    Worker *workers;     /* max_threads slots */
+    int min_threads;
+    int max_threads;
+    int live;            /* Running workers */
+    const char *doc_root;
+    const int *cpus;     /* Slot i is pinned to cpus[i % num_cpus] */
+    int num_cpus;
+
+    /* Pool controller: grows on queue wait, reaps retired workers */
+    pthread_t controller;
+    bool controller_started;
+    uint64_t grown;      /* Workers started by the controller */
+    uint64_t retired;    /* Workers that exited after lingering */
 
-    /* Statistics */
-    uint64_t total_requests;
-    uint64_t active_connections;
+    /* Connection queue */
+    FdQueue *queue;
+    EventCount ready;
+    bool shutdown;
+    uint64_t queue_deadline_us; /* Older entries are shed, 0 = never */
+    uint64_t shed_full;  /* Shed because every queue was full (atomic) */
+
+    /*
+     * Work stealing: connections go round-robin to worker inboxes (the
+     * shared queue only takes overflow) and idle workers steal
+     */
+    bool work_stealing;
+    int next_worker;     /* Round-robin cursor, accept loop only */
+
+    /*
+     * Leader/follower: workers take turns blocking in accept() on the
+     * shared listener and serve what they accept themselves
+     */
+    int listen_fd;       /* -1 when the main thread accepts */
+    int leading;         /* Leader token: a worker is in accept() */
+
+    /* Accepted connections, written by the accept loop (or the leader) */
     uint64_t total_connections;
+
+    /*
+     * Idle keep-alive connections wait in the poller's event backend
+     * rather than in a blocked worker. Workers hand them over through
+     * the park queue; the poller requeues them once readable.
+     */
+    ConnState *conns;    /* Indexed by fd */
+    int max_fds;
+    FdQueue *park;       /* Workers -> poller */
+    int park_signalled;  /* Wakeup already written, poller not yet drained */
+    int wakeup_fd;       /* eventfd, or pipe read end off Linux */
+    int wakeup_write_fd; /* Same as wakeup_fd for an eventfd */
+    EventBackend *eb;    /* Touched by the poller thread only */
+    pthread_t poller;
+    bool poller_started;
+    uint64_t parked;     /* Written by the poller */
 } ThreadPool;
 
 /* Global thread pool */
 static ThreadPool *g_pool = NULL;
 
 /* Function prototypes */
-static ThreadPool *thread_pool_create(int num_threads);
+static ThreadPool *thread_pool_create(const char *doc_root, int listen_fd,
+                                      const ThreadServerOptions *opts);
 static void thread_pool_destroy(ThreadPool *pool);
-static void thread_pool_add_connection(ThreadPool *pool, int fd, const char *doc_root);
+static void thread_pool_add_connection(ThreadPool *pool, int fd);
+static void shed_connection(ThreadPool *pool, int fd);
+static void linger_connection(ThreadPool *pool, int fd);
+static void print_stats(ThreadPool *pool);
+static int lead_accept(Worker *worker, int *fd);
+static void serve_connection(Worker *worker, int fd, uint64_t enqueued_us);
+static int submit_connection(ThreadPool *pool, int fd, int worker_hint);
+static int find_work(Worker *worker, int *fd, uint64_t *enqueued_us);
+static size_t pending_work(ThreadPool *pool);
+static int deque_push(WorkDeque *deque, int fd, uint64_t enqueued_us);
+static int deque_take(WorkDeque *deque, int *fd, uint64_t *enqueued_us);
+static int deque_steal(WorkDeque *deque, int *fd, uint64_t *enqueued_us);
+static int spawn_worker(ThreadPool *pool);
+static bool try_retire(Worker *worker);
+static void *controller_thread(void *arg);
+static uint64_t now_us(void);
+static int queue_push(FdQueue *queue, int fd, uint64_t enqueued_us);
+static int queue_pop(FdQueue *queue, int *fd, uint64_t *enqueued_us);
+static size_t queue_depth(FdQueue *queue);
+static void ec_init(EventCount *ec);
+static void ec_destroy(EventCount *ec);
+static uint32_t ec_prepare_wait(EventCount *ec);
+static void ec_cancel_wait(EventCount *ec);
+static bool ec_wait(EventCount *ec, uint32_t key, int timeout_ms);
+static void ec_notify(EventCount *ec, bool all);
+static FdQueue *queue_create(size_t capacity);
+static int poller_init(ThreadPool *pool);
+static void poller_cleanup(ThreadPool *pool);
+static void park_connection(ThreadPool *pool, int fd);
+static void poller_drain(ThreadPool *pool);
+static void *poller_thread(void *arg);
 static void *worker_thread(void *arg);
-static void handle_connection(int fd, const char *doc_root);
-static int process_request(int fd, const char *doc_root, bool *keep_alive);
-static int send_file_response(int client_fd, const char *file_path, bool keep_alive);
-static int send_error_response(int client_fd, int status_code, bool keep_alive);
+static void handle_connection(Worker *worker, int fd);
+static int process_request(ResponseBuffer *out, const char *buf, const http_req_t *request,
+                           const char *doc_root, bool keep_alive);
+static int send_file_response(ResponseBuffer *out, const char *file_path, bool keep_alive);
+static int send_error_response(ResponseBuffer *out, int status_code, bool keep_alive);
+static int response_reserve(ResponseBuffer *out, size_t len);
+static int response_flush(ResponseBuffer *out);
 static int create_server_socket(const char *bind_addr, int port);
 static void configure_socket_options(int socket_fd);
 static int increase_limits(void);
@@ -88,6 +300,16 @@ static int increase_limits(void);
  * Main server entry point with thread pool
  */
 int run_thread_server(const char *bind_addr, int port, const char *doc_root)
+{
+    ThreadServerOptions opts = {0};
+    return run_thread_server_opts(bind_addr, port, doc_root, &opts);
+}
+
+/**
+ * Server entry point with explicit options
+ */
+int run_thread_server_opts(const char *bind_addr, int port, const char *doc_root,
+                           const ThreadServerOptions *opts)
 {
     if (!doc_root)
     {
@@ -95,6 +317,22 @@ int run_thread_server(const char *bind_addr, int port, const char *doc_root)
         return -1;
     }
 
+    if (opts->queue_deadline_ms < -1)
+    {
+        fprintf(stderr, "Error: queue deadline must be -1 (off), 0 (default) or positive\n");
+        return -1;
+    }
+
+    int min_threads = opts->min_threads > 0 ? opts->min_threads : kMinWorkerThreads;
+    int max_threads = opts->max_threads > 0 ? opts->max_threads : kMaxWorkerThreads;
+    if (min_threads > max_threads)
+        min_threads = max_threads;
+    if (max_threads > kWorkerLimit)
+    {
+        fprintf(stderr, "Error: max threads must be at most %d\n", kWorkerLimit);
+        return -1;
+    }
+
     /* Increase system limits for C10K */
     if (increase_limits() < 0)
     {
@@ -104,36 +342,60 @@ int run_thread_server(const char *bind_addr, int port, const char *doc_root)
     /* Ignore SIGPIPE */
     signal(SIGPIPE, SIG_IGN);
 
-    /* Create thread pool */
-    g_pool = thread_pool_create(kMaxWorkerThreads);
-    if (!g_pool)
+    /* Create server socket */
+    int server_fd = create_server_socket(bind_addr, port);
+    if (server_fd < 0)
     {
-        fprintf(stderr, "Failed to create thread pool\n");
         return -1;
     }
 
-    /* Create server socket */
-    int server_fd = create_server_socket(bind_addr, port);
-    if (server_fd < 0)
+    /* Create thread pool; leader/follower workers accept on server_fd */
+    ThreadServerOptions pool_opts = *opts;
+    pool_opts.min_threads = min_threads;
+    pool_opts.max_threads = max_threads;
+    g_pool = thread_pool_create(doc_root, opts->leader_follower ? server_fd : -1, &pool_opts);
+    if (!g_pool)
     {
-        thread_pool_destroy(g_pool);
+        fprintf(stderr, "Failed to create thread pool\n");
+        close(server_fd);
         return -1;
     }
 
     fprintf(stderr, "Thread pool server listening on %s:%d (doc_root: %s)\n",
             bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
-    fprintf(stderr, "Thread pool size: %d workers\n", kMaxWorkerThreads);
+    fprintf(stderr, "Thread pool size: %d-%d workers, %s, idle keep-alive parked in %s\n",
+            min_threads, max_threads,
+            opts->work_stealing ? "work-stealing deques" : "shared queue", eb_name());
+    if (opts->leader_follower)
+    {
+        fprintf(stderr, "Accept: leader/follower, workers serve what they accept\n");
+    }
+    if (g_pool->queue_deadline_us > 0)
+    {
+        fprintf(stderr, "Load shedding: 503 after %llu ms in the queue or when it is full\n",
+                (unsigned long long)(g_pool->queue_deadline_us / 1000));
+    }
+    if (opts->num_cpus > 0)
+    {
+        fprintf(stderr, "Pinning: workers round-robin over %d CPUs\n", opts->num_cpus);
+    }
+
+    /* Workers do the accepting: this thread only reports */
+    while (opts->leader_follower)
+    {
+        sleep(kStatsIntervalSec);
+        print_stats(g_pool);
+    }
 
     /* Main accept loop */
     while (1)
     {
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-
-        int client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &addr_len);
+        /* Socket options are inherited from the listener */
+        int client_fd = accept_cloexec(server_fd);
         if (client_fd < 0)
         {
-            if (errno == EINTR)
+            /* EAGAIN: listener SO_RCVTIMEO expired with no connection */
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
                 continue;
             if (errno == EMFILE || errno == ENFILE)
             {
@@ -145,70 +407,255 @@ int run_thread_server(const char *bind_addr, int port, const char *doc_root)
             continue;
         }
 
-        /* Configure client socket */
-        configure_socket_options(client_fd);
-
         /* Add to thread pool queue */
-        thread_pool_add_connection(g_pool, client_fd, doc_root);
+        thread_pool_add_connection(g_pool, client_fd);
 
         /* Print stats periodically */
         static time_t last_stats = 0;
         time_t now = time(NULL);
-        if (now - last_stats >= 10)
+        if (now - last_stats >= kStatsIntervalSec)
         {
-            fprintf(stderr, "Stats: queue=%d active=%llu total=%llu requests=%llu\n",
-                    g_pool->queue_size,
-                    (unsigned long long)g_pool->active_connections,
-                    (unsigned long long)g_pool->total_connections,
-                    (unsigned long long)g_pool->total_requests);
+            print_stats(g_pool);
             last_stats = now;
         }
     }
 
     /* Cleanup (unreachable) */
-    close(server_fd);
     thread_pool_destroy(g_pool);
+    close(server_fd);
     return 0;
 }
 
+/**
+ * Print stats summed over the workers' shards
+ */
+static void print_stats(ThreadPool *pool)
+{
+    uint64_t active = 0, requests = 0, shed_late = 0;
+    for (int i = 0; i < pool->max_threads; i++)
+    {
+        active += STAT_READ(pool->workers[i].active);
+        requests += STAT_READ(pool->workers[i].requests);
+        shed_late += STAT_READ(pool->workers[i].shed);
+    }
+
+    fprintf(stderr, "Stats: workers=%d grown=%llu retired=%llu queue=%zu active=%llu "
+                    "parked=%llu total=%llu requests=%llu shed_full=%llu shed_late=%llu\n",
+            __atomic_load_n(&pool->live, __ATOMIC_RELAXED),
+            (unsigned long long)STAT_READ(pool->grown),
+            (unsigned long long)STAT_READ(pool->retired),
+            pending_work(pool),
+            (unsigned long long)active,
+            (unsigned long long)STAT_READ(pool->parked),
+            (unsigned long long)STAT_READ(pool->total_connections),
+            (unsigned long long)requests,
+            (unsigned long long)__atomic_load_n(&pool->shed_full, __ATOMIC_RELAXED),
+            (unsigned long long)shed_late);
+}
+
 /**
  * Create thread pool
+ *
+ * Starts min_threads workers and the controller that sizes the pool
+ * between min_threads and max_threads. With a CPU list, the worker in
+ * slot i is pinned to cpus[i % num_cpus]. A listen_fd other than -1
+ * selects leader/follower accept on that socket.
  */
-static ThreadPool *thread_pool_create(int num_threads)
+static ThreadPool *thread_pool_create(const char *doc_root, int listen_fd,
+                                      const ThreadServerOptions *opts)
 {
     ThreadPool *pool = calloc(1, sizeof(ThreadPool));
     if (!pool)
         return NULL;
 
-    pool->num_threads = num_threads;
-    pool->threads = calloc(num_threads, sizeof(pthread_t));
-    if (!pool->threads)
+    pool->min_threads = opts->min_threads;
+    pool->max_threads = opts->max_threads;
+    pool->doc_root = doc_root;
+    pool->cpus = opts->cpus;
+    pool->num_cpus = opts->num_cpus;
+    pool->work_stealing = opts->work_stealing;
+    pool->listen_fd = listen_fd;
+    pool->queue_deadline_us = opts->queue_deadline_ms < 0    ? 0
+                              : opts->queue_deadline_ms == 0 ? kQueueDeadlineMs * 1000ULL
+                                                             : opts->queue_deadline_ms * 1000ULL;
+    pool->workers = aligned_alloc(_Alignof(Worker), pool->max_threads * sizeof(Worker));
+    pool->queue = queue_create(kQueueSize);
+    if (!pool->workers || !pool->queue)
     {
+        free(pool->workers);
+        free(pool->queue);
         free(pool);
         return NULL;
     }
+    memset(pool->workers, 0, pool->max_threads * sizeof(Worker));
+
+    ec_init(&pool->ready);
+
+    if (pool->work_stealing)
+    {
+        for (int i = 0; i < pool->max_threads; i++)
+        {
+            pool->workers[i].inbox = queue_create(kInboxSize);
+            if (!pool->workers[i].inbox)
+            {
+                thread_pool_destroy(pool);
+                return NULL;
+            }
+        }
+    }
+
+    if (poller_init(pool) < 0)
+    {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    /* Create the initial workers */
+    while (pool->live < pool->min_threads)
+    {
+        if (spawn_worker(pool) < 0)
+        {
+            fprintf(stderr, "Failed to create worker thread %d\n", pool->live);
+            break;
+        }
+    }
+
+    if (pool->live == 0 ||
+        pthread_create(&pool->controller, NULL, controller_thread, pool) != 0)
+    {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    pool->controller_started = true;
+
+    return pool;
+}
+
+/**
+ * Start a worker in a free slot; called by the creating thread, then
+ * only by the controller
+ */
+static int spawn_worker(ThreadPool *pool)
+{
+    Worker *worker = NULL;
+    for (int i = 0; i < pool->max_threads; i++)
+    {
+        if (__atomic_load_n(&pool->workers[i].state, __ATOMIC_ACQUIRE) == WORKER_IDLE_SLOT)
+        {
+            worker = &pool->workers[i];
+            worker->cpu = pool->num_cpus > 0 ? pool->cpus[i % pool->num_cpus] : -1;
+            break;
+        }
+    }
+    if (!worker)
+        return -1;
 
-    pthread_mutex_init(&pool->queue_mutex, NULL);
-    pthread_cond_init(&pool->queue_cond, NULL);
+    worker->pool = pool;
+    worker->state = WORKER_RUNNING;
+    __atomic_fetch_add(&pool->live, 1, __ATOMIC_SEQ_CST);
 
-    /* Configure thread attributes */
     pthread_attr_t attr;
     pthread_attr_init(&attr);
     pthread_attr_setstacksize(&attr, kThreadStackSize);
+    int ret = pthread_create(&worker->thread, &attr, worker_thread, worker);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0)
+    {
+        __atomic_fetch_sub(&pool->live, 1, __ATOMIC_SEQ_CST);
+        worker->state = WORKER_IDLE_SLOT;
+        return -1;
+    }
+
+    return 0;
+}
 
-    /* Create worker threads */
-    for (int i = 0; i < num_threads; i++)
+/**
+ * Let an idle worker exit if the pool stays at or above min_threads
+ */
+static bool try_retire(Worker *worker)
+{
+    ThreadPool *pool = worker->pool;
+    int live = __atomic_load_n(&pool->live, __ATOMIC_RELAXED);
+
+    do
+    {
+        if (live <= pool->min_threads)
+            return false;
+    } while (!__atomic_compare_exchange_n(&pool->live, &live, live - 1, true,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    STAT_ADD(pool->retired, 1);
+    __atomic_store_n(&worker->state, WORKER_EXITED, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Pool controller
+ *
+ * Every tick it joins retired workers and measures how long connections
+ * sat in the queue. After kGrowTicks ticks in a row with a mean wait
+ * above kGrowWaitUs it adds a quarter of the live workers, or as many
+ * as are queued if that is more. A non-empty queue that nobody popped
+ * from for a whole tick means every worker is blocked, and grows the
+ * pool right away. In leader/follower mode, no leader in accept() for
+ * kGrowTicks ticks means every worker is busy, and counts as backlog
+ * too. Shrinking is left to the workers themselves, which retire after
+ * kWorkerLingerMs idle.
+ */
+static void *controller_thread(void *arg)
+{
+    ThreadPool *pool = (ThreadPool *)arg;
+    uint64_t last_wait_us = 0, last_waits = 0;
+    int backlogged = 0;
+
+    while (!__atomic_load_n(&pool->shutdown, __ATOMIC_SEQ_CST))
     {
-        if (pthread_create(&pool->threads[i], &attr, worker_thread, pool) != 0)
+        struct timespec tick = {0, kControlIntervalMs * 1000000L};
+        nanosleep(&tick, NULL);
+
+        uint64_t wait_us = 0, waits = 0;
+        for (int i = 0; i < pool->max_threads; i++)
         {
-            fprintf(stderr, "Failed to create worker thread %d\n", i);
-            pool->num_threads = i;
-            break;
+            Worker *worker = &pool->workers[i];
+            if (__atomic_load_n(&worker->state, __ATOMIC_ACQUIRE) == WORKER_EXITED)
+            {
+                pthread_join(worker->thread, NULL);
+                worker->state = WORKER_IDLE_SLOT;
+            }
+            wait_us += STAT_READ(worker->wait_us);
+            waits += STAT_READ(worker->waits);
+        }
+
+        uint64_t tick_waits = waits - last_waits;
+        uint64_t tick_wait_us = wait_us - last_wait_us;
+        last_waits = waits;
+        last_wait_us = wait_us;
+
+        int depth = (int)pending_work(pool);
+        bool starved = tick_waits == 0 && depth > 0;
+        bool slow = tick_waits > 0 && tick_wait_us / tick_waits > kGrowWaitUs;
+        bool leaderless = pool->listen_fd >= 0 &&
+                          !__atomic_load_n(&pool->leading, __ATOMIC_SEQ_CST);
+        backlogged = starved ? kGrowTicks : slow || leaderless ? backlogged + 1 : 0;
+
+        if (backlogged < kGrowTicks)
+            continue;
+        backlogged = 0;
+
+        int live = __atomic_load_n(&pool->live, __ATOMIC_RELAXED);
+        int grow = live / 4 > depth ? live / 4 : depth;
+        if (grow < 1)
+            grow = 1;
+        for (int i = 0; i < grow && live + i < pool->max_threads; i++)
+        {
+            if (spawn_worker(pool) < 0)
+                break;
+            STAT_ADD(pool->grown, 1);
         }
     }
 
-    pthread_attr_destroy(&attr);
-    return pool;
+    return NULL;
 }
 
 /**
@@ -219,275 +666,1091 @@ static void thread_pool_destroy(ThreadPool *pool)
     if (!pool)
         return;
 
-    /* Signal shutdown */
-    pthread_mutex_lock(&pool->queue_mutex);
-    pool->shutdown = true;
-    pthread_cond_broadcast(&pool->queue_cond);
-    pthread_mutex_unlock(&pool->queue_mutex);
+    /* Signal shutdown; the controller goes first so no worker is added */
+    __atomic_store_n(&pool->shutdown, true, __ATOMIC_SEQ_CST);
+    if (pool->controller_started)
+        pthread_join(pool->controller, NULL);
+    ec_notify(&pool->ready, true);
+    if (pool->listen_fd >= 0)
+        shutdown(pool->listen_fd, SHUT_RDWR); /* Fails a leader's accept() */
 
-    /* Wait for threads */
-    for (int i = 0; i < pool->num_threads; i++)
+    /* Wait for threads, including retired ones not yet reaped */
+    for (int i = 0; i < pool->max_threads; i++)
     {
-        pthread_join(pool->threads[i], NULL);
+        if (pool->workers[i].state != WORKER_IDLE_SLOT)
+            pthread_join(pool->workers[i].thread, NULL);
     }
+    if (pool->conns)
+        poller_cleanup(pool);
 
     /* Cleanup queue */
-    while (pool->queue_head)
+    int fd;
+    uint64_t enqueued_us;
+    while (queue_pop(pool->queue, &fd, &enqueued_us) == 0)
+    {
+        close(fd);
+    }
+    for (int i = 0; i < pool->max_threads; i++)
     {
-        Connection *conn = pool->queue_head;
-        pool->queue_head = conn->next;
-        close(conn->fd);
-        free(conn);
+        Worker *worker = &pool->workers[i];
+        while (deque_take(&worker->deque, &fd, &enqueued_us) == 0)
+            close(fd);
+        while (worker->inbox && queue_pop(worker->inbox, &fd, &enqueued_us) == 0)
+            close(fd);
+        free(worker->inbox);
     }
 
-    pthread_mutex_destroy(&pool->queue_mutex);
-    pthread_cond_destroy(&pool->queue_cond);
-    free(pool->threads);
+    ec_destroy(&pool->ready);
+    free(pool->queue);
+    free(pool->workers);
     free(pool);
 }
 
 /**
  * Add connection to thread pool queue
  */
-static void thread_pool_add_connection(ThreadPool *pool, int fd, const char *doc_root)
+static void thread_pool_add_connection(ThreadPool *pool, int fd)
 {
-    Connection *conn = malloc(sizeof(Connection));
-    if (!conn)
+    if (fd >= pool->max_fds)
     {
         close(fd);
         return;
     }
+    pool->conns[fd].fd = fd;
+    pool->conns[fd].requests = 0;
+    pool->conns[fd].last_worker = -1;
+    pool->conns[fd].lingering = false;
 
-    conn->fd = fd;
-    conn->doc_root = doc_root;
-    conn->next = NULL;
+    STAT_ADD(pool->total_connections, 1);
+
+    /* Queue full: fail fast rather than let it wait */
+    if (submit_connection(pool, fd, -1) < 0)
+    {
+        __atomic_fetch_add(&pool->shed_full, 1, __ATOMIC_RELAXED);
+        shed_connection(pool, fd);
+    }
+}
 
-    pthread_mutex_lock(&pool->queue_mutex);
+/**
+ * Answer 503 with Retry-After and close
+ *
+ * The request usually has not been read (or has not even arrived), so
+ * the close lingers rather than leaving the calling thread to drain it.
+ */
+static void shed_connection(ThreadPool *pool, int fd)
+{
+    send(fd, kServiceUnavailable, sizeof(kServiceUnavailable) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    linger_connection(pool, fd);
+}
 
-    /* Check queue size limit */
-    if (pool->queue_size >= kQueueSize)
+/**
+ * Close after the final response without losing it to a RST
+ *
+ * Closing a socket with unread input makes the kernel reset the
+ * connection, and the client may drop the response it has not read
+ * yet. Send FIN instead and let the poller discard what still arrives
+ * until the client closes or kLingerTimeoutMs passes.
+ */
+static void linger_connection(ThreadPool *pool, int fd)
+{
+    if (shutdown(fd, SHUT_WR) < 0)
     {
-        pthread_mutex_unlock(&pool->queue_mutex);
         close(fd);
-        free(conn);
         return;
     }
 
-    /* Add to queue */
-    if (pool->queue_tail)
+    pool->conns[fd].lingering = true;
+    park_connection(pool, fd);
+}
+
+/**
+ * Queue a connection that has a request to serve and wake a worker
+ *
+ * With work stealing it goes to worker_hint's inbox, or the next worker
+ * round-robin for a hint of -1 (accept loop only); a full inbox spills
+ * into the shared queue.
+ *
+ * @return 0 on success, -1 if every queue is full
+ */
+static int submit_connection(ThreadPool *pool, int fd, int worker_hint)
+{
+    uint64_t now = now_us();
+    int pushed = -1;
+
+    if (pool->work_stealing)
     {
-        pool->queue_tail->next = conn;
+        if (worker_hint < 0)
+        {
+            /* Next running worker; retired slots are still stolen from */
+            for (int i = 0; i < pool->max_threads; i++)
+            {
+                worker_hint = pool->next_worker;
+                pool->next_worker = (pool->next_worker + 1) % pool->max_threads;
+                if (__atomic_load_n(&pool->workers[worker_hint].state, __ATOMIC_ACQUIRE) ==
+                    WORKER_RUNNING)
+                    break;
+            }
+        }
+        pushed = queue_push(pool->workers[worker_hint].inbox, fd, now);
     }
-    else
+
+    if (pushed < 0 && queue_push(pool->queue, fd, now) < 0)
     {
-        pool->queue_head = conn;
+        return -1;
     }
-    pool->queue_tail = conn;
-    pool->queue_size++;
-    pool->total_connections++;
 
-    pthread_cond_signal(&pool->queue_cond);
-    pthread_mutex_unlock(&pool->queue_mutex);
+    ec_notify(&pool->ready, false);
+    return 0;
 }
 
 /**
- * Worker thread function
+ * Get the next connection for a worker
+ *
+ * Shared-queue mode just pops the queue. With work stealing the order
+ * is: own deque, own inbox (moved into the deque in a batch), shared
+ * overflow queue, then other workers' deques and inboxes.
+ *
+ * @return 0 with fd set, -1 if there is no work anywhere
  */
-static void *worker_thread(void *arg)
+static int find_work(Worker *worker, int *fd, uint64_t *enqueued_us)
 {
-    ThreadPool *pool = (ThreadPool *)arg;
+    ThreadPool *pool = worker->pool;
 
-    while (1)
+    if (!pool->work_stealing)
     {
-        pthread_mutex_lock(&pool->queue_mutex);
-
-        /* Wait for connections */
-        while (!pool->queue_head && !pool->shutdown)
-        {
-            pthread_cond_wait(&pool->queue_cond, &pool->queue_mutex);
-        }
-
-        if (pool->shutdown)
-        {
-            pthread_mutex_unlock(&pool->queue_mutex);
-            break;
-        }
-
-        /* Get connection from queue */
-        Connection *conn = pool->queue_head;
-        pool->queue_head = conn->next;
-        if (!pool->queue_head)
-        {
-            pool->queue_tail = NULL;
-        }
-        pool->queue_size--;
-        pool->active_connections++;
+        return queue_pop(pool->queue, fd, enqueued_us);
+    }
 
-        pthread_mutex_unlock(&pool->queue_mutex);
+    if (deque_take(&worker->deque, fd, enqueued_us) == 0)
+        return 0;
 
-        /* Handle connection with keep-alive support */
-        handle_connection(conn->fd, conn->doc_root);
+    /* Deque is empty here, so a batch always fits */
+    int moved = 0;
+    while (moved < kInboxBatch && queue_pop(worker->inbox, fd, enqueued_us) == 0)
+    {
+        deque_push(&worker->deque, *fd, *enqueued_us);
+        moved++;
+    }
+    if (moved > 0 && deque_take(&worker->deque, fd, enqueued_us) == 0)
+        return 0;
 
-        /* Update stats */
-        pthread_mutex_lock(&pool->queue_mutex);
-        pool->active_connections--;
-        pthread_mutex_unlock(&pool->queue_mutex);
+    if (queue_pop(pool->queue, fd, enqueued_us) == 0)
+        return 0;
 
-        free(conn);
+    /* Steal, starting after ourselves so thieves spread out */
+    int self = (int)(worker - pool->workers);
+    for (int i = 1; i < pool->max_threads; i++)
+    {
+        Worker *victim = &pool->workers[(self + i) % pool->max_threads];
+        if (deque_steal(&victim->deque, fd, enqueued_us) == 0 ||
+            queue_pop(victim->inbox, fd, enqueued_us) == 0)
+            return 0;
     }
 
-    return NULL;
+    return -1;
 }
 
 /**
- * Handle connection with keep-alive support
+ * Approximate number of queued connections, over every queue in use
  */
-static void handle_connection(int fd, const char *doc_root)
+static size_t pending_work(ThreadPool *pool)
 {
-    bool keep_alive = true;
-    int requests = 0;
+    size_t depth = queue_depth(pool->queue);
 
-    while (keep_alive && requests < kKeepAliveMax)
+    for (int i = 0; pool->work_stealing && i < pool->max_threads; i++)
     {
-        if (process_request(fd, doc_root, &keep_alive) < 0)
-        {
-            break;
-        }
-        requests++;
-
-        /* Update global stats */
-        if (g_pool)
-        {
-            __atomic_fetch_add(&g_pool->total_requests, 1, __ATOMIC_RELAXED);
-        }
-
-        if (!keep_alive)
-            break;
-
-        /* Set timeout for next request */
-        struct timeval tv = {
-            .tv_sec = kKeepAliveTimeout,
-            .tv_usec = 0};
-        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        WorkDeque *deque = &pool->workers[i].deque;
+        int64_t size = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) -
+                       __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+        depth += queue_depth(pool->workers[i].inbox) + (size > 0 ? (size_t)size : 0);
     }
 
-    close(fd);
+    return depth;
 }
 
 /**
- * Process a single HTTP request
+ * Owner: push at the bottom; returns -1 if the deque is full
  */
-static int process_request(int fd, const char *doc_root, bool *keep_alive)
+static int deque_push(WorkDeque *deque, int fd, uint64_t enqueued_us)
 {
-    char request_buffer[kMaxRequestSize];
-    char file_path[kMaxPathSize];
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
 
-    /* Read request */
-    ssize_t bytes_read = recv(fd, request_buffer, sizeof(request_buffer) - 1, 0);
-    if (bytes_read <= 0)
+    if (b - t >= kDequeSize)
     {
         return -1;
     }
-    request_buffer[bytes_read] = '\0';
 
-    /* Parse request */
-    http_req_t request;
-    if (http_parse_request(request_buffer, bytes_read, &request) <= 0)
-    {
-        send_error_response(fd, 400, false);
-        *keep_alive = false;
-        return -1;
-    }
+    DequeEntry *entry = &deque->entries[b & (kDequeSize - 1)];
+    __atomic_store_n(&entry->fd, fd, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->enqueued_us, enqueued_us, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+}
 
-    /* Check for keep-alive */
-    *keep_alive = (strstr(request_buffer, "Connection: keep-alive") != NULL ||
-                   strstr(request_buffer, "HTTP/1.1") != NULL);
+/**
+ * Owner: take the newest entry from the bottom; returns -1 if empty
+ */
+static int deque_take(WorkDeque *deque, int *fd, uint64_t *enqueued_us)
+{
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
 
-    /* Build file path */
-    if (http_safe_join(file_path, sizeof(file_path), doc_root, request.path) < 0)
+    if (t > b)
     {
-        send_error_response(fd, 404, *keep_alive);
-        return 0;
+        /* Empty */
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return -1;
     }
 
-    /* Check file */
-    struct stat file_stat;
-    if (stat(file_path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    DequeEntry *entry = &deque->entries[b & (kDequeSize - 1)];
+    *fd = __atomic_load_n(&entry->fd, __ATOMIC_RELAXED);
+    *enqueued_us = __atomic_load_n(&entry->enqueued_us, __ATOMIC_RELAXED);
+
+    if (t == b)
     {
-        send_error_response(fd, 404, *keep_alive);
-        return 0;
+        /* Last entry: race thieves for it */
+        bool won = __atomic_compare_exchange_n(&deque->top, &t, t + 1, false,
+                                               __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return won ? 0 : -1;
     }
 
-    /* Send response */
-    return send_file_response(fd, file_path, *keep_alive);
+    return 0;
 }
 
 /**
- * Send file response with keep-alive support
+ * Thief: take the oldest entry from the top; returns -1 if empty or
+ * another thread got it first
  */
-static int send_file_response(int client_fd, const char *file_path, bool keep_alive)
+static int deque_steal(WorkDeque *deque, int *fd, uint64_t *enqueued_us)
 {
-    int file_fd = open(file_path, O_RDONLY);
-    if (file_fd < 0)
-    {
-        return send_error_response(client_fd, 500, keep_alive);
-    }
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
 
-    struct stat file_stat;
-    if (fstat(file_fd, &file_stat) != 0)
-    {
-        close(file_fd);
-        return send_error_response(client_fd, 500, keep_alive);
-    }
-
-    /* Build header with keep-alive */
-    char header[kMaxHeaderSize];
-    int header_len = snprintf(header, sizeof(header),
-                              "HTTP/1.1 200 OK\r\n"
-                              "Content-Length: %lld\r\n"
-                              "Content-Type: %s\r\n"
-                              "Connection: %s\r\n"
-                              "\r\n",
-                              (long long)file_stat.st_size,
-                              http_guess_type(file_path),
-                              keep_alive ? "keep-alive" : "close");
-
-    if (send(client_fd, header, header_len, MSG_NOSIGNAL) < 0)
+    if (t >= b)
     {
-        close(file_fd);
         return -1;
     }
 
-    /* Send file using sendfile or read/write */
-    char buffer[kFileBufferSize];
-    ssize_t bytes_read;
+    /* May read a slot being reused; the CAS then fails and we drop it */
+    DequeEntry *entry = &deque->entries[t & (kDequeSize - 1)];
+    int value = __atomic_load_n(&entry->fd, __ATOMIC_RELAXED);
+    uint64_t stamp = __atomic_load_n(&entry->enqueued_us, __ATOMIC_RELAXED);
 
-    while ((bytes_read = read(file_fd, buffer, sizeof(buffer))) > 0)
+    if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
     {
-        ssize_t total_sent = 0;
-        while (total_sent < bytes_read)
-        {
-            ssize_t sent = send(client_fd, buffer + total_sent,
-                                bytes_read - total_sent, MSG_NOSIGNAL);
-            if (sent <= 0)
-            {
-                close(file_fd);
-                return -1;
-            }
-            total_sent += sent;
-        }
+        return -1;
     }
 
-    close(file_fd);
+    *fd = value;
+    *enqueued_us = stamp;
     return 0;
 }
 
 /**
- * Send error response with keep-alive support
+ * Allocate an empty fd queue; capacity must be a power of 2
  */
-static int send_error_response(int client_fd, int status_code, bool keep_alive)
+static FdQueue *queue_create(size_t capacity)
 {
-    const char *status_text;
+    FdQueue *queue = aligned_alloc(_Alignof(FdQueue),
+                                   sizeof(FdQueue) + capacity * sizeof(QueueCell));
+    if (!queue)
+        return NULL;
+
+    /* Cell i is free for the producer at position i */
+    queue->mask = capacity - 1;
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        queue->cells[i].seq = i;
+    }
+
+    return queue;
+}
+
+/**
+ * Push an fd; returns -1 if the queue is full
+ */
+static int queue_push(FdQueue *queue, int fd, uint64_t enqueued_us)
+{
+    size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    QueueCell *cell;
+
+    while (1)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            /* Free cell: claim the position */
+            if (__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return -1; /* Consumer has not freed it yet: full */
+        }
+        else
+        {
+            pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->fd = fd;
+    cell->enqueued_us = enqueued_us;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Pop an fd; returns -1 if the queue is empty
+ */
+static int queue_pop(FdQueue *queue, int *fd, uint64_t *enqueued_us)
+{
+    size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    QueueCell *cell;
+
+    while (1)
+    {
+        cell = &queue->cells[pos & queue->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            /* Filled cell: claim the position */
+            if (__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return -1; /* Producer has not filled it yet: empty */
+        }
+        else
+        {
+            pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    *fd = cell->fd;
+    *enqueued_us = cell->enqueued_us;
+    /* Free the cell for the producer one lap later */
+    __atomic_store_n(&cell->seq, pos + queue->mask + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Monotonic clock in microseconds, for queue wait accounting
+ */
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * Approximate number of queued fds, for stats
+ */
+static size_t queue_depth(FdQueue *queue)
+{
+    size_t tail = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+    size_t head = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+    return tail > head ? tail - head : 0;
+}
+
+static void ec_init(EventCount *ec)
+{
+    ec->seq = 0;
+    ec->waiters = 0;
+#ifndef __linux__
+    pthread_mutex_init(&ec->mutex, NULL);
+    pthread_cond_init(&ec->cond, NULL);
+#endif
+}
+
+static void ec_destroy(EventCount *ec)
+{
+#ifndef __linux__
+    pthread_mutex_destroy(&ec->mutex);
+    pthread_cond_destroy(&ec->cond);
+#else
+    (void)ec;
+#endif
+}
+
+/**
+ * Announce a waiter; the caller must re-check its condition afterwards
+ * and then either ec_wait() on the returned key or ec_cancel_wait()
+ */
+static uint32_t ec_prepare_wait(EventCount *ec)
+{
+    uint32_t key = __atomic_load_n(&ec->seq, __ATOMIC_ACQUIRE);
+    __atomic_fetch_add(&ec->waiters, 1, __ATOMIC_SEQ_CST);
+    /* Pairs with the fence in ec_notify(): the re-check sees the push */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return key;
+}
+
+static void ec_cancel_wait(EventCount *ec)
+{
+    __atomic_fetch_sub(&ec->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Sleep unless a notify happened since ec_prepare_wait() returned key
+ *
+ * @return false if timeout_ms passed without a notify
+ */
+static bool ec_wait(EventCount *ec, uint32_t key, int timeout_ms)
+{
+    bool woken = true;
+#ifdef __linux__
+    /* Returns at once (EAGAIN) if seq already moved past key */
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000};
+    if (syscall(SYS_futex, &ec->seq, FUTEX_WAIT_PRIVATE, key, &ts, NULL, 0) < 0 &&
+        errno == ETIMEDOUT)
+        woken = false;
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&ec->mutex);
+    while (woken && __atomic_load_n(&ec->seq, __ATOMIC_ACQUIRE) == key)
+    {
+        if (pthread_cond_timedwait(&ec->cond, &ec->mutex, &deadline) == ETIMEDOUT)
+            woken = false;
+    }
+    pthread_mutex_unlock(&ec->mutex);
+#endif
+    __atomic_fetch_sub(&ec->waiters, 1, __ATOMIC_SEQ_CST);
+    return woken;
+}
+
+/**
+ * Wake one (or all) sleepers; free when nobody is waiting
+ */
+static void ec_notify(EventCount *ec, bool all)
+{
+    /* Orders the caller's publish before the waiters check (Dekker) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ec->waiters, __ATOMIC_RELAXED) == 0)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    __atomic_fetch_add(&ec->seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &ec->seq, FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&ec->mutex);
+    __atomic_fetch_add(&ec->seq, 1, __ATOMIC_RELEASE);
+    if (all)
+        pthread_cond_broadcast(&ec->cond);
+    else
+        pthread_cond_signal(&ec->cond);
+    pthread_mutex_unlock(&ec->mutex);
+#endif
+}
+
+/**
+ * Set up the keep-alive poller: fd state table, park queue, wakeup fd,
+ * event backend, and its thread
+ */
+static int poller_init(ThreadPool *pool)
+{
+    struct rlimit rlim;
+    pool->max_fds = getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur != RLIM_INFINITY
+                        ? (int)rlim.rlim_cur
+                        : 65536;
+    pool->wakeup_fd = -1;
+    pool->wakeup_write_fd = -1;
+
+    pool->conns = calloc(pool->max_fds, sizeof(ConnState));
+    pool->park = queue_create(kQueueSize);
+    pool->eb = eb_create(1024);
+    if (!pool->conns || !pool->park || !pool->eb)
+    {
+        perror("poller_init");
+        poller_cleanup(pool);
+        return -1;
+    }
+
+#ifdef __linux__
+    pool->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pool->wakeup_write_fd = pool->wakeup_fd;
+    if (pool->wakeup_fd < 0)
+#else
+    int fds[2];
+    if (pipe(fds) == 0)
+    {
+        pool->wakeup_fd = fds[0];
+        pool->wakeup_write_fd = fds[1];
+        set_nonblock(fds[0]);
+        set_nonblock(fds[1]);
+    }
+    if (pool->wakeup_fd < 0)
+#endif
+    {
+        perror("wakeup fd");
+        poller_cleanup(pool);
+        return -1;
+    }
+
+    /* udata = park queue marks the wakeup fd */
+    if (eb_register(pool->eb, pool->wakeup_fd, kEbRead, pool->park) < 0 ||
+        pthread_create(&pool->poller, NULL, poller_thread, pool) != 0)
+    {
+        fprintf(stderr, "Failed to start keep-alive poller\n");
+        poller_cleanup(pool);
+        return -1;
+    }
+    pool->poller_started = true;
+
+    return 0;
+}
+
+/**
+ * Stop the poller and close every connection still parked
+ */
+static void poller_cleanup(ThreadPool *pool)
+{
+    if (pool->poller_started)
+    {
+        /* shutdown is already set; the wakeup makes the poller see it */
+        park_connection(pool, -1);
+        pthread_join(pool->poller, NULL);
+        pool->poller_started = false;
+
+        for (int fd = 0; fd < pool->max_fds; fd++)
+        {
+            if (pool->conns[fd].timer.next)
+                close(fd);
+        }
+    }
+
+    if (pool->park)
+    {
+        int fd;
+        uint64_t enqueued_us;
+        while (queue_pop(pool->park, &fd, &enqueued_us) == 0)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    if (pool->wakeup_write_fd >= 0 && pool->wakeup_write_fd != pool->wakeup_fd)
+        close(pool->wakeup_write_fd);
+    if (pool->wakeup_fd >= 0)
+        close(pool->wakeup_fd);
+    if (pool->eb)
+        eb_destroy(pool->eb);
+    free(pool->park);
+    free(pool->conns);
+    pool->park = NULL;
+    pool->conns = NULL;
+    pool->eb = NULL;
+}
+
+/**
+ * Hand an idle keep-alive connection to the poller
+ *
+ * Only the first park after a drain writes the wakeup fd; later ones
+ * ride along until the poller clears park_signalled.
+ */
+static void park_connection(ThreadPool *pool, int fd)
+{
+    if (queue_push(pool->park, fd, 0) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    if (__atomic_exchange_n(&pool->park_signalled, 1, __ATOMIC_SEQ_CST) == 0)
+    {
+        uint64_t one = 1;
+        ssize_t n = write(pool->wakeup_write_fd, &one, sizeof(one));
+        (void)n; /* Full pipe/counter: a wakeup is pending anyway */
+    }
+}
+
+/**
+ * Register newly parked connections with the keep-alive deadline
+ */
+static void poller_drain(ThreadPool *pool)
+{
+    uint64_t buf[8];
+    while (read(pool->wakeup_fd, buf, sizeof(buf)) > 0)
+    {
+    }
+
+    /* Cleared before draining, so a later park signals again */
+    __atomic_store_n(&pool->park_signalled, 0, __ATOMIC_SEQ_CST);
+
+    int fd;
+    uint64_t enqueued_us;
+    while (queue_pop(pool->park, &fd, &enqueued_us) == 0)
+    {
+        if (fd < 0)
+            continue; /* Shutdown nudge */
+
+        ConnState *state = &pool->conns[fd];
+        if (eb_register(pool->eb, fd, kEbRead, state) < 0)
+        {
+            close(fd);
+            continue;
+        }
+        eb_timer_schedule(pool->eb, &state->timer,
+                          state->lingering ? kLingerTimeoutMs : kKeepAliveTimeout * 1000);
+        STAT_ADD(pool->parked, 1);
+    }
+}
+
+/**
+ * Keep-alive poller: holds idle connections without a thread each and
+ * requeues them to the workers when their next request arrives
+ */
+static void *poller_thread(void *arg)
+{
+    ThreadPool *pool = (ThreadPool *)arg;
+    EbEvent events[kMaxPollEvents];
+
+    while (!__atomic_load_n(&pool->shutdown, __ATOMIC_SEQ_CST))
+    {
+        int nev = eb_wait(pool->eb, events, kMaxPollEvents, -1);
+        if (nev < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("eb_wait");
+            break;
+        }
+
+        for (int i = 0; i < nev; i++)
+        {
+            if (events[i].udata == pool->park)
+            {
+                poller_drain(pool);
+                continue;
+            }
+
+            ConnState *state = (ConnState *)events[i].udata;
+
+            /* Lingering close: discard until EOF, one read per event */
+            if (state->lingering)
+            {
+                char discard[kMaxRequestSize];
+                ssize_t n = recv(state->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
+                    continue;
+
+                eb_timer_cancel(pool->eb, &state->timer);
+                eb_close(pool->eb, state->fd);
+                STAT_ADD(pool->parked, -1);
+                continue;
+            }
+
+            eb_timer_cancel(pool->eb, &state->timer);
+            STAT_ADD(pool->parked, -1);
+
+            /* Readable (request bytes or EOF): back to a worker */
+            if (!(events[i].events & kEbRead) || eb_unregister(pool->eb, state->fd) < 0)
+            {
+                eb_close(pool->eb, state->fd);
+                continue;
+            }
+
+            /* Back to the worker that served it last, caches still warm */
+            if (submit_connection(pool, state->fd, state->last_worker) < 0)
+            {
+                __atomic_fetch_add(&pool->shed_full, 1, __ATOMIC_RELAXED);
+                shed_connection(pool, state->fd);
+            }
+        }
+
+        /* Keep-alive timeouts */
+        TimerNode expired;
+        timer_wheel_list_init(&expired);
+        eb_expire(pool->eb, &expired);
+
+        TimerNode *node;
+        while ((node = timer_wheel_list_pop(&expired)) != NULL)
+        {
+            ConnState *state = timer_entry(node, ConnState, timer);
+            eb_close(pool->eb, state->fd);
+            STAT_ADD(pool->parked, -1);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Worker thread function
+ */
+static void *worker_thread(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    ThreadPool *pool = worker->pool;
+
+    /*
+     * Pin before touching anything: the request and file buffers live on
+     * this thread's stack, so their pages land on the pinned CPU's node
+     */
+    if (worker->cpu >= 0 && pin_current_thread(worker->cpu) < 0)
+    {
+        fprintf(stderr, "Warning: worker not pinned to CPU %d: %s\n",
+                worker->cpu, strerror(errno));
+    }
+
+    while (1)
+    {
+        int fd;
+        uint64_t enqueued_us;
+
+        if (find_work(worker, &fd, &enqueued_us) < 0)
+        {
+            /* Nothing queued: lead if nobody is accepting */
+            if (pool->listen_fd >= 0 && lead_accept(worker, &fd) == 0)
+            {
+                serve_connection(worker, fd, 0);
+                continue;
+            }
+
+            /* Empty: register as a sleeper, then look once more */
+            uint32_t key = ec_prepare_wait(&pool->ready);
+
+            if (__atomic_load_n(&pool->shutdown, __ATOMIC_SEQ_CST))
+            {
+                ec_cancel_wait(&pool->ready);
+                break;
+            }
+
+            if (find_work(worker, &fd, &enqueued_us) < 0)
+            {
+                /* Leadership went free meanwhile: take it, do not sleep */
+                if (pool->listen_fd >= 0 && !__atomic_load_n(&pool->leading, __ATOMIC_SEQ_CST))
+                {
+                    ec_cancel_wait(&pool->ready);
+                    continue;
+                }
+
+                /* Idle for a whole linger period: shrink the pool */
+                if (!ec_wait(&pool->ready, key, kWorkerLingerMs) &&
+                    pending_work(pool) == 0 && try_retire(worker))
+                    return NULL;
+                continue;
+            }
+            ec_cancel_wait(&pool->ready);
+        }
+
+        serve_connection(worker, fd, enqueued_us);
+    }
+
+    return NULL;
+}
+
+/**
+ * Leader/follower: if no worker is accepting, take the leader token and
+ * block in accept(); hand the token on to a sleeping follower before
+ * serving the connection on this thread, with no queue in between
+ *
+ * @return 0 with fd set, -1 if another worker leads or accept() failed
+ */
+static int lead_accept(Worker *worker, int *fd)
+{
+    ThreadPool *pool = worker->pool;
+    int expected = 0;
+
+    if (!__atomic_compare_exchange_n(&pool->leading, &expected, 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+        return -1;
+    }
+
+    /* EAGAIN every kSocketTimeoutSec from the listener's SO_RCVTIMEO */
+    int client_fd = accept_cloexec(pool->listen_fd);
+    int err = errno;
+
+    /* Promote a follower */
+    __atomic_store_n(&pool->leading, 0, __ATOMIC_SEQ_CST);
+    ec_notify(&pool->ready, false);
+
+    if (client_fd < 0)
+    {
+        if (err == EMFILE || err == ENFILE)
+            usleep(1000); /* Too many open files, wait a bit */
+        return -1;
+    }
+
+    if (client_fd >= pool->max_fds)
+    {
+        close(client_fd);
+        return -1;
+    }
+
+    pool->conns[client_fd].fd = client_fd;
+    pool->conns[client_fd].requests = 0;
+    pool->conns[client_fd].last_worker = -1;
+    pool->conns[client_fd].lingering = false;
+    STAT_ADD(pool->total_connections, 1); /* Leaders are serialized by the token */
+
+    *fd = client_fd;
+    return 0;
+}
+
+/**
+ * Serve a connection on this worker; enqueued_us of 0 means it did not
+ * come through a queue
+ *
+ * One that waited past the queue deadline is shed instead: by now the
+ * client has likely given up, and serving it late only delays the
+ * connections queued behind it.
+ */
+static void serve_connection(Worker *worker, int fd, uint64_t enqueued_us)
+{
+    ThreadPool *pool = worker->pool;
+
+    if (enqueued_us)
+    {
+        uint64_t wait_us = now_us() - enqueued_us;
+        STAT_ADD(worker->wait_us, wait_us);
+        STAT_ADD(worker->waits, 1);
+
+        if (pool->queue_deadline_us && wait_us > pool->queue_deadline_us)
+        {
+            STAT_ADD(worker->shed, 1);
+            shed_connection(pool, fd);
+            return;
+        }
+    }
+
+    /* Handle connection with keep-alive support */
+    STAT_ADD(worker->active, 1);
+    STAT_ADD(worker->connections, 1);
+    handle_connection(worker, fd);
+    STAT_ADD(worker->active, -1);
+}
+
+/**
+ * Handle connection with keep-alive and pipelining support
+ *
+ * Bytes beyond the current request stay in the read buffer for the
+ * next one. The connection is only parked once the buffer is empty, so
+ * nothing needs to survive a trip through the poller.
+ */
+static void handle_connection(Worker *worker, int fd)
+{
+    ThreadPool *pool = worker->pool;
+    ConnState *state = &pool->conns[fd];
+    ResponseBuffer out;
+    char in[kMaxRequestSize];
+    size_t in_len = 0;
+    http_parser_t parser; /* Scan position survives partial reads */
+    bool keep_alive = true;
+    bool served = false;
+    bool forced = false; /* Server-side close: 400, close or kKeepAliveMax */
+
+    out.fd = fd;
+    out.len = 0;
+    http_parser_init(&parser);
+    state->last_worker = (int)(worker - pool->workers);
+
+    while (1)
+    {
+        /* Serve every complete request already buffered */
+        int parsed = http_parser_execute(&parser, in, in_len);
+        if (parsed < 0)
+        {
+            send_error_response(&out, 400, false);
+            forced = true;
+            break;
+        }
+        if (parsed > 0)
+        {
+            size_t request_len = parser.pos;
+
+            /* The last request allowed on this connection says so */
+            keep_alive = parser.req.keep_alive && state->requests + 1 < kKeepAliveMax;
+            state->requests++;
+            if (process_request(&out, in, &parser.req, pool->doc_root, keep_alive) < 0)
+            {
+                break;
+            }
+
+            /* Per-thread shard, summed when printed */
+            STAT_ADD(worker->requests, 1);
+            served = true;
+
+            in_len -= request_len;
+            memmove(in, in + request_len, in_len);
+            http_parser_init(&parser);
+
+            if (!keep_alive)
+            {
+                forced = true;
+                break;
+            }
+            continue;
+        }
+
+        if (in_len == sizeof(in))
+        {
+            /* Headers do not fit */
+            send_error_response(&out, 400, false);
+            forced = true;
+            break;
+        }
+
+        /* Out of complete requests: one write for all their responses */
+        if (response_flush(&out) < 0)
+        {
+            close(fd);
+            return;
+        }
+
+        /*
+         * A partial request or a fresh connection blocks for the rest
+         * (bounded by SO_RCVTIMEO); an idle keep-alive connection is
+         * parked instead of holding this worker
+         */
+        int flags = served && in_len == 0 ? MSG_DONTWAIT : 0;
+        ssize_t n = recv(fd, in + in_len, sizeof(in) - in_len, flags);
+        if (n > 0)
+        {
+            in_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && flags && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            park_connection(pool, fd);
+            return;
+        }
+        break; /* EOF, error or receive timeout */
+    }
+
+    /* Unread or pipelined input would turn a plain close into a RST */
+    if (response_flush(&out) == 0 && (forced || in_len > 0))
+    {
+        linger_connection(pool, fd);
+        return;
+    }
+    close(fd);
+}
+
+/**
+ * Process a single parsed HTTP request, appending the response to out
+ *
+ * @param buf Read buffer the request's slices point into
+ * @return 0 on success, -1 if the connection failed
+ */
+static int process_request(ResponseBuffer *out, const char *buf, const http_req_t *request,
+                           const char *doc_root, bool keep_alive)
+{
+    char file_path[kMaxPathSize];
+
+    /* Build file path */
+    if (http_safe_join(file_path, sizeof(file_path), doc_root,
+                       buf + request->target.off, request->target.len) < 0)
+    {
+        return send_error_response(out, 404, keep_alive);
+    }
+
+    /* Check file */
+    struct stat file_stat;
+    if (stat(file_path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        return send_error_response(out, 404, keep_alive);
+    }
+
+    /* Send response */
+    return send_file_response(out, file_path, keep_alive);
+}
+
+/**
+ * Send file response with keep-alive support
+ */
+static int send_file_response(ResponseBuffer *out, const char *file_path, bool keep_alive)
+{
+    int file_fd = open(file_path, O_RDONLY);
+    if (file_fd < 0)
+    {
+        return send_error_response(out, 500, keep_alive);
+    }
+
+    struct stat file_stat;
+    if (fstat(file_fd, &file_stat) != 0)
+    {
+        close(file_fd);
+        return send_error_response(out, 500, keep_alive);
+    }
+
+    /* Build header with keep-alive */
+    if (response_reserve(out, kMaxHeaderSize) < 0)
+    {
+        close(file_fd);
+        return -1;
+    }
+    out->len += (size_t)snprintf(out->data + out->len, kMaxHeaderSize,
+                                 "HTTP/1.1 200 OK\r\n"
+                                 "Content-Length: %lld\r\n"
+                                 "Content-Type: %s\r\n"
+                                 "Connection: %s\r\n"
+                                 "\r\n",
+                                 (long long)file_stat.st_size,
+                                 http_guess_type(file_path),
+                                 keep_alive ? "keep-alive" : "close");
+
+    /* Body straight into the response buffer, flushing when it fills */
+    while (1)
+    {
+        if (out->len == sizeof(out->data) && response_flush(out) < 0)
+        {
+            close(file_fd);
+            return -1;
+        }
+
+        ssize_t bytes_read = read(file_fd, out->data + out->len, sizeof(out->data) - out->len);
+        if (bytes_read < 0)
+        {
+            close(file_fd);
+            return -1; /* Header already out: only closing is honest */
+        }
+        if (bytes_read == 0)
+            break;
+        out->len += (size_t)bytes_read;
+    }
+
+    close(file_fd);
+    return 0;
+}
+
+/**
+ * Send error response with keep-alive support
+ */
+static int send_error_response(ResponseBuffer *out, int status_code, bool keep_alive)
+{
+    const char *status_text;
     const char *body;
 
     switch (status_code)
@@ -508,20 +1771,55 @@ static int send_error_response(int client_fd, int status_code, bool keep_alive)
         return -1;
     }
 
-    char response[kMaxHeaderSize];
-    int response_len = snprintf(response, sizeof(response),
-                                "HTTP/1.1 %s\r\n"
-                                "Content-Length: %zu\r\n"
-                                "Content-Type: text/plain\r\n"
-                                "Connection: %s\r\n"
-                                "\r\n"
-                                "%s",
-                                status_text,
-                                strlen(body),
-                                keep_alive ? "keep-alive" : "close",
-                                body);
+    if (response_reserve(out, kMaxHeaderSize) < 0)
+    {
+        return -1;
+    }
+    out->len += (size_t)snprintf(out->data + out->len, kMaxHeaderSize,
+                                 "HTTP/1.1 %s\r\n"
+                                 "Content-Length: %zu\r\n"
+                                 "Content-Type: text/plain\r\n"
+                                 "Connection: %s\r\n"
+                                 "\r\n"
+                                 "%s",
+                                 status_text,
+                                 strlen(body),
+                                 keep_alive ? "keep-alive" : "close",
+                                 body);
+    return 0;
+}
 
-    return send(client_fd, response, response_len, MSG_NOSIGNAL) < 0 ? -1 : 0;
+/**
+ * Make room for len bytes, flushing what is buffered if needed
+ */
+static int response_reserve(ResponseBuffer *out, size_t len)
+{
+    if (out->len + len > sizeof(out->data))
+    {
+        return response_flush(out);
+    }
+    return 0;
+}
+
+/**
+ * Write out everything buffered
+ */
+static int response_flush(ResponseBuffer *out)
+{
+    size_t sent = 0;
+
+    while (sent < out->len)
+    {
+        ssize_t n = send(out->fd, out->data + sent, out->len - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+
+    out->len = 0;
+    return 0;
 }
 
 /**
@@ -553,6 +1851,9 @@ static int create_server_socket(const char *bind_addr, int port)
     }
 #endif
 
+    /* Set per-connection options once; accepted sockets inherit them */
+    configure_socket_options(server_fd);
+
     /* Bind */
     struct sockaddr_in server_addr = {
         .sin_family = AF_INET,
@@ -579,6 +1880,9 @@ static int create_server_socket(const char *bind_addr, int port)
 
 /**
  * Configure socket for performance
+ *
+ * Applied to the listening socket: TCP_NODELAY, the timeouts and the
+ * buffer sizes are all copied to each accepted socket by the kernel.
  */
 static void configure_socket_options(int socket_fd)
 {
@@ -1,6 +1,25 @@
 #ifndef THREAD_SERVER_H
 #define THREAD_SERVER_H
 
+/* Tuning knobs for run_thread_server_opts() */
+typedef struct
+{
+    const int *cpus; /* Worker i is pinned to cpus[i % num_cpus];
+                        NULL = unpinned */
+    int num_cpus;
+    int min_threads; /* Workers kept even when idle; 0 = default (8) */
+    int max_threads; /* Ceiling for queue-driven growth; 0 = default (200) */
+    int work_stealing; /* Per-worker inboxes and Chase-Lev deques with
+                          stealing instead of one shared MPMC queue */
+    int leader_follower; /* Workers take turns in accept() and serve what
+                            they accept, instead of the main thread
+                            accepting into the queue */
+    int queue_deadline_ms; /* Connections queued longer get 503 with
+                              Retry-After, as do those arriving to a
+                              full queue; 0 = default (1000), -1 = only
+                              shed when full */
+} ThreadServerOptions;
+
 /**
  * Starts the thread-based HTTP server
  *
@@ -11,4 +30,19 @@
  */
 int run_thread_server(const char *bind_addr, int port, const char *doc_root);
 
+/**
+ * Starts the thread-based HTTP server with explicit options
+ *
+ * @param bind_addr IP address to bind (NULL for INADDR_ANY)
+ * @param port      Port number to listen on
+ * @param doc_root  Document root directory path
+ * The pool starts at min_threads and grows while connections wait in
+ * the queue; workers idle for 10 s retire down to min_threads.
+ *
+ * @param opts      Pool bounds, scheduler, accept model and pinning
+ * @return          0 on success, -1 on failure
+ */
+int run_thread_server_opts(const char *bind_addr, int port, const char *doc_root,
+                           const ThreadServerOptions *opts);
+
 #endif /* THREAD_SERVER_H */
\ No newline at end of file
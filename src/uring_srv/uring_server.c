@@ -0,0 +1,835 @@
+/**
+ * io_uring-based HTTP Server Implementation (Linux)
+ *
+ * Design goals:
+ * - Completion-based I/O: accept, recv, send and file reads are all
+ *   submitted to a single io_uring
+ * - One io_uring_enter() per loop turn submits every queued operation
+ *   and reaps completions, amortizing syscalls across connections
+ * - Same connection pool and request handling as the kqueue/epoll servers
+ *
+ * The ring (common/uring.c) is driven through the raw io_uring syscalls
+ * so the server has no dependency beyond kernel headers.
+ */
+
+#include "uring_server.h"
+#include "../common/http.h"
+#include "../common/uring.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+/* Configuration */
+enum
+{
+    kRingEntries = 4096,         /* Submission queue depth */
+    kMaxConnections = 50000,     /* Support up to 50K connections */
+    kRequestBufferSize = 4096,   /* HTTP request buffer */
+    kResponseBufferSize = 32768, /* Response chunk size */
+    kPathBufferSize = 1024,      /* File path buffer */
+    kListenBacklog = 10000,      /* Listen queue size - match somaxconn */
+};
+
+/* Operation tag stored in the low bits of user_data */
+typedef enum
+{
+    OP_ACCEPT,
+    OP_RECV,
+    OP_SEND,
+    OP_READ,
+    OP_MASK = 3
+} RingOp;
+
+/* Connection states */
+typedef enum
+{
+    STATE_READING_REQUEST,
+    STATE_READING_FILE,
+    STATE_SENDING_RESPONSE,
+    STATE_CLOSING
+} ConnectionState;
+
+/*
+ * Connection structure
+ *
+ * A connection has at most one operation in flight, so it can be
+ * returned to the pool as soon as that operation completes.
+ */
+typedef struct Connection
+{
+    int fd;
+    ConnectionState state;
+
+    /* Request handling */
+    char *request_buffer;
+    size_t request_size;
+    size_t request_capacity;
+    http_parser_t *parser; /* Same allocation as request_buffer */
+
+    /* Response handling (header and file chunks share the buffer) */
+    char *response_buffer;
+    size_t response_size;
+    size_t response_sent;
+
+    /* File serving */
+    int file_fd;
+    off_t file_offset;
+    off_t file_size;
+
+    /* For connection pool */
+    struct Connection *next;
+} Connection;
+
+/* Server context */
+typedef struct Server
+{
+    Ring ring;            /* Submission/completion ring */
+    int listen_fd;        /* Listening socket */
+    const char *doc_root; /* Document root */
+
+    /* Connection pool */
+    Connection *connections; /* Array of all connections */
+    Connection *free_list;   /* Free connection list */
+    int num_active;          /* Active connections count */
+
+    /* Statistics */
+    uint64_t total_requests;
+    uint64_t total_bytes_sent;
+    uint64_t total_connections;
+    uint64_t total_enters;
+} Server;
+
+/* Function prototypes */
+static int increase_fd_limit(void);
+static int create_listen_socket(const char *bind_addr, int port);
+static Connection *alloc_connection(Server *server);
+static void close_connection(Server *server, Connection *conn);
+static void queue_accept(Server *server);
+static void queue_recv(Server *server, Connection *conn);
+static void queue_send(Server *server, Connection *conn);
+static void queue_file_read(Server *server, Connection *conn, size_t buf_offset);
+static void handle_completion(Server *server, uint64_t user_data, int res);
+static void handle_accept(Server *server, int res);
+static int handle_recv(Server *server, Connection *conn, int res);
+static int handle_send(Server *server, Connection *conn, int res);
+static int handle_file_read(Server *server, Connection *conn, int res);
+static int process_request(Server *server, Connection *conn, const http_req_t *request);
+static int prepare_file_response(Server *server, Connection *conn, const char *file_path);
+static int prepare_error_response(Server *server, Connection *conn, int status_code);
+
+/**
+ * Main server entry point
+ */
+int run_uring_server(const char *bind_addr, int port, const char *doc_root)
+{
+    if (!doc_root)
+    {
+        fprintf(stderr, "Error: document root required\n");
+        return -1;
+    }
+
+    /* Increase file descriptor limit for C10K+ */
+    if (increase_fd_limit() < 0)
+    {
+        fprintf(stderr, "Warning: Could not increase fd limit\n");
+    }
+
+    /* Ignore SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Initialize server - heap allocated, the ring state is large */
+    Server *server = calloc(1, sizeof(Server));
+    if (!server)
+    {
+        perror("calloc");
+        return -1;
+    }
+    server->doc_root = doc_root;
+
+    /* Create ring */
+    if (ring_init(&server->ring, kRingEntries) < 0)
+    {
+        perror("io_uring_setup");
+        free(server);
+        return -1;
+    }
+
+    /* Create listening socket */
+    server->listen_fd = create_listen_socket(bind_addr, port);
+    if (server->listen_fd < 0)
+    {
+        ring_destroy(&server->ring);
+        free(server);
+        return -1;
+    }
+
+    /* Initialize connection pool */
+    server->connections = calloc(kMaxConnections, sizeof(Connection));
+    if (!server->connections)
+    {
+        perror("calloc");
+        close(server->listen_fd);
+        ring_destroy(&server->ring);
+        free(server);
+        return -1;
+    }
+
+    /* Build free list */
+    for (int i = 0; i < kMaxConnections - 1; i++)
+    {
+        server->connections[i].next = &server->connections[i + 1];
+        server->connections[i].fd = -1;
+        server->connections[i].file_fd = -1;
+    }
+    server->connections[kMaxConnections - 1].fd = -1;
+    server->connections[kMaxConnections - 1].file_fd = -1;
+    server->free_list = &server->connections[0];
+
+    fprintf(stderr, "io_uring server listening on %s:%d (doc_root: %s)\n",
+            bind_addr ? bind_addr : "0.0.0.0", port, doc_root);
+    fprintf(stderr, "Max connections: %d, ring entries: %u\n",
+            kMaxConnections, server->ring.sq_entries);
+
+    /* Keep one accept in flight at all times */
+    queue_accept(server);
+
+    /* Event loop */
+    Ring *ring = &server->ring;
+    int running = 1;
+
+    while (running)
+    {
+        /* Submit everything queued last turn and wait for a completion */
+        if (ring_enter(ring, 1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("io_uring_enter");
+            break;
+        }
+        server->total_enters++;
+
+        /* Reap completions */
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail)
+        {
+            struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+            handle_completion(server, cqe->user_data, cqe->res);
+            head++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        /* Print stats periodically */
+        static time_t last_stats = 0;
+        static int max_active = 0;
+        time_t now = time(NULL);
+
+        if (server->num_active > max_active)
+            max_active = server->num_active;
+
+        if (now - last_stats >= 10)
+        {
+            fprintf(stderr, "Stats: active=%d max=%d total=%llu requests=%llu bytes=%llu enters=%llu\n",
+                    server->num_active,
+                    max_active,
+                    (unsigned long long)server->total_connections,
+                    (unsigned long long)server->total_requests,
+                    (unsigned long long)server->total_bytes_sent,
+                    (unsigned long long)server->total_enters);
+            last_stats = now;
+        }
+    }
+
+    /* Cleanup */
+    for (int i = 0; i < kMaxConnections; i++)
+    {
+        if (server->connections[i].fd >= 0)
+        {
+            close(server->connections[i].fd);
+        }
+        if (server->connections[i].file_fd >= 0)
+        {
+            close(server->connections[i].file_fd);
+        }
+        free(server->connections[i].parser);
+        free(server->connections[i].response_buffer);
+    }
+    free(server->connections);
+    close(server->listen_fd);
+    ring_destroy(&server->ring);
+    free(server);
+
+    return 0;
+}
+
+/**
+ * Increase file descriptor limit for C10K+
+ */
+static int increase_fd_limit(void)
+{
+    struct rlimit rlim;
+
+    /* Get current limits */
+    if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        return -1;
+    }
+
+    /* Try to set to maximum */
+    rlim.rlim_cur = rlim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+    {
+        /* Try a reasonable value */
+        rlim.rlim_cur = 65536;
+        rlim.rlim_max = 65536;
+        if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+        {
+            return -1;
+        }
+    }
+
+    fprintf(stderr, "File descriptor limit: %llu\n",
+            (unsigned long long)rlim.rlim_cur);
+    return 0;
+}
+
+/**
+ * Create and configure listening socket
+ *
+ * The socket stays blocking: io_uring arms its own poll for pending
+ * accepts, and accepted sockets inherit TCP_NODELAY from the listener.
+ */
+static int create_listen_socket(const char *bind_addr, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    /* Allow address reuse */
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    {
+        perror("SO_REUSEADDR");
+        close(fd);
+        return -1;
+    }
+
+#ifdef SO_REUSEPORT
+    /* Allow port reuse (load balancing) */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        /* Non-fatal */
+    }
+#endif
+
+    /* Inherited by accepted sockets */
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    /* Bind */
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = bind_addr ? inet_addr(bind_addr) : INADDR_ANY};
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    /* Listen */
+    if (listen(fd, kListenBacklog) < 0)
+    {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Allocate connection from pool
+ */
+static Connection *alloc_connection(Server *server)
+{
+    if (!server->free_list)
+    {
+        return NULL; /* Pool exhausted */
+    }
+
+    Connection *conn = server->free_list;
+    server->free_list = conn->next;
+    conn->next = NULL;
+
+    conn->state = STATE_READING_REQUEST;
+    conn->request_size = 0;
+    conn->response_size = 0;
+    conn->response_sent = 0;
+    conn->file_fd = -1;
+    conn->file_offset = 0;
+    conn->file_size = 0;
+
+    server->num_active++;
+    server->total_connections++;
+
+    return conn;
+}
+
+/**
+ * Close connection and return it to the pool
+ *
+ * Only called from a completion handler, so no operation is in flight.
+ */
+static void close_connection(Server *server, Connection *conn)
+{
+    if (conn->fd >= 0)
+    {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+
+    if (conn->file_fd >= 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+    }
+
+    conn->state = STATE_CLOSING;
+    conn->next = server->free_list;
+    server->free_list = conn;
+    server->num_active--;
+}
+
+/**
+ * Queue an accept on the listening socket
+ */
+static void queue_accept(Server *server)
+{
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe)
+    {
+        fprintf(stderr, "io_uring: cannot queue accept\n");
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->listen_fd;
+    sqe->user_data = OP_ACCEPT;
+}
+
+/**
+ * Queue a recv into the free tail of the request buffer
+ */
+static void queue_recv(Server *server, Connection *conn)
+{
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe)
+    {
+        close_connection(server, conn);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(conn->request_buffer + conn->request_size);
+    sqe->len = (uint32_t)(conn->request_capacity - conn->request_size - 1);
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_RECV;
+    conn->state = STATE_READING_REQUEST;
+}
+
+/**
+ * Queue a send of the unsent part of the response buffer
+ */
+static void queue_send(Server *server, Connection *conn)
+{
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe)
+    {
+        close_connection(server, conn);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(conn->response_buffer + conn->response_sent);
+    sqe->len = (uint32_t)(conn->response_size - conn->response_sent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_SEND;
+    conn->state = STATE_SENDING_RESPONSE;
+}
+
+/**
+ * Queue a read of the next file chunk into the response buffer
+ */
+static void queue_file_read(Server *server, Connection *conn, size_t buf_offset)
+{
+    struct io_uring_sqe *sqe = ring_get_sqe(&server->ring);
+    if (!sqe)
+    {
+        close_connection(server, conn);
+        return;
+    }
+
+    size_t to_read = kResponseBufferSize - buf_offset;
+    if ((off_t)to_read > conn->file_size - conn->file_offset)
+    {
+        to_read = conn->file_size - conn->file_offset;
+    }
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = conn->file_fd;
+    sqe->addr = (uint64_t)(uintptr_t)(conn->response_buffer + buf_offset);
+    sqe->len = (uint32_t)to_read;
+    sqe->off = (uint64_t)conn->file_offset;
+    sqe->user_data = (uint64_t)(uintptr_t)conn | OP_READ;
+    conn->state = STATE_READING_FILE;
+}
+
+/**
+ * Dispatch one completion
+ */
+static void handle_completion(Server *server, uint64_t user_data, int res)
+{
+    RingOp op = (RingOp)(user_data & OP_MASK);
+    Connection *conn = (Connection *)(uintptr_t)(user_data & ~(uint64_t)OP_MASK);
+    int ret = 0;
+
+    switch (op)
+    {
+    case OP_ACCEPT:
+        handle_accept(server, res);
+        return;
+
+    case OP_RECV:
+        ret = handle_recv(server, conn, res);
+        break;
+
+    case OP_SEND:
+        ret = handle_send(server, conn, res);
+        break;
+
+    case OP_READ:
+        ret = handle_file_read(server, conn, res);
+        break;
+
+    default:
+        return;
+    }
+
+    if (ret < 0)
+    {
+        close_connection(server, conn);
+    }
+}
+
+/**
+ * Handle accept completion and re-arm the accept
+ */
+static void handle_accept(Server *server, int res)
+{
+    queue_accept(server);
+
+    if (res < 0)
+    {
+        if (res != -EAGAIN && res != -EINTR)
+        {
+            fprintf(stderr, "accept: %s\n", strerror(-res));
+        }
+        return;
+    }
+
+    /* Get connection from pool */
+    Connection *conn = alloc_connection(server);
+    if (!conn)
+    {
+        close(res); /* Pool exhausted */
+        return;
+    }
+
+    conn->fd = res;
+
+    /* Allocate buffers on demand - lazy allocation saves memory */
+    if (!conn->request_buffer)
+    {
+        conn->parser = malloc(sizeof(http_parser_t) + kRequestBufferSize);
+        if (!conn->parser)
+        {
+            close_connection(server, conn);
+            return;
+        }
+        conn->request_buffer = (char *)(conn->parser + 1);
+        conn->request_capacity = kRequestBufferSize;
+    }
+
+    queue_recv(server, conn);
+}
+
+/**
+ * Handle recv completion
+ */
+static int handle_recv(Server *server, Connection *conn, int res)
+{
+    if (res <= 0)
+    {
+        return -1; /* Connection closed or error */
+    }
+
+    if (conn->request_size == 0)
+    {
+        http_parser_init(conn->parser);
+    }
+    conn->request_size += res;
+
+    /* Only the new bytes are scanned; a complete header fills parser->req */
+    int parsed = http_parser_execute(conn->parser, conn->request_buffer, conn->request_size);
+    if (parsed < 0)
+    {
+        return prepare_error_response(server, conn, 400); /* Bad Request */
+    }
+    if (parsed > 0)
+    {
+        return process_request(server, conn, &conn->parser->req);
+    }
+
+    /* Check buffer overflow */
+    if (conn->request_size >= conn->request_capacity - 1)
+    {
+        return prepare_error_response(server, conn, 413); /* Request Too Large */
+    }
+
+    queue_recv(server, conn);
+    return 0;
+}
+
+/**
+ * Handle send completion
+ */
+static int handle_send(Server *server, Connection *conn, int res)
+{
+    if (res <= 0)
+    {
+        return -1; /* Error */
+    }
+
+    conn->response_sent += res;
+    server->total_bytes_sent += res;
+
+    /* Short send - queue the remainder */
+    if (conn->response_sent < conn->response_size)
+    {
+        queue_send(server, conn);
+        return 0;
+    }
+
+    /* More file data to stream */
+    if (conn->file_fd >= 0 && conn->file_offset < conn->file_size)
+    {
+        conn->response_size = 0;
+        conn->response_sent = 0;
+        queue_file_read(server, conn, 0);
+        return 0;
+    }
+
+    return -1; /* Done, close connection */
+}
+
+/**
+ * Handle file read completion
+ */
+static int handle_file_read(Server *server, Connection *conn, int res)
+{
+    if (res <= 0)
+    {
+        return -1; /* Error or file truncated */
+    }
+
+    conn->file_offset += res;
+    conn->response_size += res;
+    queue_send(server, conn);
+    return 0;
+}
+
+/**
+ * Process HTTP request
+ */
+static int process_request(Server *server, Connection *conn, const http_req_t *request)
+{
+    char file_path[kPathBufferSize];
+
+    /* Build file path */
+    if (http_safe_join(file_path, sizeof(file_path),
+                       server->doc_root, conn->request_buffer + request->target.off,
+                       request->target.len) < 0)
+    {
+        return prepare_error_response(server, conn, 404); /* Not Found */
+    }
+
+    /* Prepare response */
+    int ret = prepare_file_response(server, conn, file_path);
+    if (ret == 404)
+    {
+        return prepare_error_response(server, conn, 404); /* Not Found */
+    }
+    if (ret < 0)
+    {
+        return prepare_error_response(server, conn, 500); /* Internal Server Error */
+    }
+
+    server->total_requests++;
+    return 0;
+}
+
+/**
+ * Prepare file response
+ *
+ * The header is placed at the start of the response buffer and the
+ * first file chunk is read directly behind it, so small files go out
+ * in a single send. Returns 404 if the path is not a regular file.
+ */
+static int prepare_file_response(Server *server, Connection *conn, const char *file_path)
+{
+    /* Open file */
+    conn->file_fd = open(file_path, O_RDONLY);
+    if (conn->file_fd < 0)
+    {
+        return (errno == ENOENT || errno == ENOTDIR) ? 404 : -1;
+    }
+
+    /* Get file size */
+    struct stat st;
+    if (fstat(conn->file_fd, &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+        return 404;
+    }
+
+    conn->file_size = st.st_size;
+    conn->file_offset = 0;
+
+    /* Allocate response buffer if needed */
+    if (!conn->response_buffer)
+    {
+        conn->response_buffer = malloc(kResponseBufferSize);
+        if (!conn->response_buffer)
+        {
+            close(conn->file_fd);
+            conn->file_fd = -1;
+            return -1;
+        }
+    }
+
+    /* Build header */
+    int header_len = http_build_200(conn->response_buffer, kResponseBufferSize,
+                                    st.st_size, http_guess_type(file_path), 0);
+    if (header_len < 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+        return -1;
+    }
+
+    conn->response_size = header_len;
+    conn->response_sent = 0;
+
+    if (conn->file_size > 0)
+    {
+        queue_file_read(server, conn, header_len);
+    }
+    else
+    {
+        queue_send(server, conn);
+    }
+
+    return 0;
+}
+
+/**
+ * Prepare error response
+ */
+static int prepare_error_response(Server *server, Connection *conn, int status_code)
+{
+    /* Allocate buffer if needed */
+    if (!conn->response_buffer)
+    {
+        conn->response_buffer = malloc(kResponseBufferSize);
+        if (!conn->response_buffer)
+        {
+            return -1;
+        }
+    }
+
+    char *response = conn->response_buffer;
+    int response_len = 0;
+
+    switch (status_code)
+    {
+    case 400:
+        response_len = snprintf(response, kResponseBufferSize,
+                                "HTTP/1.1 400 Bad Request\r\n"
+                                "Content-Length: 11\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Bad Request");
+        break;
+
+    case 404:
+        response_len = http_build_404(response, kResponseBufferSize, 0);
+        break;
+
+    case 413:
+        response_len = snprintf(response, kResponseBufferSize,
+                                "HTTP/1.1 413 Request Entity Too Large\r\n"
+                                "Content-Length: 17\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Request Too Large");
+        break;
+
+    case 500:
+        response_len = snprintf(response, kResponseBufferSize,
+                                "HTTP/1.1 500 Internal Server Error\r\n"
+                                "Content-Length: 21\r\n"
+                                "Connection: close\r\n\r\n"
+                                "Internal Server Error");
+        break;
+
+    default:
+        return -1;
+    }
+
+    if (response_len <= 0 || response_len >= kResponseBufferSize)
+    {
+        return -1;
+    }
+
+    if (conn->file_fd >= 0)
+    {
+        close(conn->file_fd);
+        conn->file_fd = -1;
+    }
+
+    conn->response_size = response_len;
+    conn->response_sent = 0;
+    queue_send(server, conn);
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef URING_SERVER_H
+#define URING_SERVER_H
+
+/**
+ * io_uring-based HTTP Server (Linux)
+ * 
+ * Completion-based server that submits accept, recv, send and file
+ * reads through a single io_uring, batched once per loop turn.
+ */
+
+/**
+ * Starts the io_uring-based HTTP server
+ * 
+ * @param bind_addr IP address to bind (NULL for INADDR_ANY)
+ * @param port      Port number to listen on
+ * @param doc_root  Document root directory path
+ * @return          0 on success, -1 on failure
+ */
+int run_uring_server(const char *bind_addr, int port, const char *doc_root);
+
+#endif /* URING_SERVER_H */
@@ -12,16 +12,34 @@ NC='\033[0m'
 echo -e "${GREEN}=== Testing All Servers ===${NC}"
 echo
 
+# Event-driven server depends on the platform
+EVENT_NAME="Kqueue"
+EVENT_BIN="./build/kqueue_http"
+URING_BIN=""
+if [ "$(uname -s)" = "Linux" ]; then
+    EVENT_NAME="Epoll"
+    EVENT_BIN="./build/epoll_http"
+    URING_BIN="./build/uring_http"
+fi
+
 # Build if needed
-if [ ! -f "./build/thread_http" ] || [ ! -f "./build/kqueue_http" ] || [ ! -f "./build/aio_http" ]; then
+if [ ! -f "./build/thread_http" ] || [ ! -f "$EVENT_BIN" ] || [ ! -f "./build/aio_http" ] ||
+   [ ! -f "./build/coro_http" ] || [ -n "$URING_BIN" -a ! -f "$URING_BIN" ]; then
     echo -e "${YELLOW}Building servers...${NC}"
     make clean && make all
 fi
 
+# A file larger than any response buffer, generated rather than tracked
+BIG_FILE="www/_big_test.bin"
+BIG_SIZE=300000
+head -c $BIG_SIZE /dev/urandom > "$BIG_FILE"
+trap 'rm -f "$BIG_FILE"' EXIT
+
 # Function to test a server
 test_server() {
     local name=$1
     local binary=$2
+    local keep_alive=$3
     
     echo -e "${GREEN}Testing $name server...${NC}"
     
@@ -42,7 +60,36 @@ test_server() {
     else
         echo -e "${RED}✗ $name basic test failed${NC}"
     fi
-    
+
+    # Large file arrives whole
+    if [ "$(curl -s -o /dev/null -w '%{size_download}' http://localhost:8080/_big_test.bin)" = "$BIG_SIZE" ]; then
+        echo -e "${GREEN}✓ $name large file passed${NC}"
+    else
+        echo -e "${RED}✗ $name large file failed${NC}"
+    fi
+
+    # Timers armed after an idle spell must still run from now
+    sleep 6
+    if curl -s http://localhost:8080/index.html | grep -q "C Server Benchmark"; then
+        echo -e "${GREEN}✓ $name request after idle passed${NC}"
+    else
+        echo -e "${RED}✗ $name request after idle failed${NC}"
+    fi
+
+    # Second request, a second later, reuses the connection parked after the first
+    if [ "$keep_alive" = "keep-alive" ]; then
+        local replies
+        replies=$( { exec 3<>/dev/tcp/127.0.0.1/8080 &&
+            printf 'GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n' >&3 && sleep 1 &&
+            printf 'GET /index.html HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n' >&3 &&
+            cat <&3; } 2>/dev/null | grep -c "HTTP/1.1 200" || true)
+        if [ "$replies" = "2" ]; then
+            echo -e "${GREEN}✓ $name keep-alive after idle passed${NC}"
+        else
+            echo -e "${RED}✗ $name keep-alive after idle failed${NC}"
+        fi
+    fi
+
     # Simple load test with ab if available
     if command -v ab &> /dev/null; then
         echo -n "  Load test (100 connections): "
@@ -62,8 +109,12 @@ test_server() {
 }
 
 # Test each server
-test_server "Thread Pool" "./build/thread_http"
-test_server "Kqueue" "./build/kqueue_http"
-test_server "Select/AIO" "./build/aio_http"
+test_server "Thread Pool" "./build/thread_http" keep-alive
+test_server "$EVENT_NAME" "$EVENT_BIN" keep-alive
+test_server "Poll/AIO" "./build/aio_http" keep-alive
+test_server "Coroutine" "./build/coro_http" keep-alive
+if [ -n "$URING_BIN" ]; then
+    test_server "io_uring" "$URING_BIN"
+fi
 
 echo -e "${GREEN}=== All Tests Complete ===${NC}"
\ No newline at end of file